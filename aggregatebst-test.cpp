@@ -0,0 +1,121 @@
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include "aggregatebst.h"
+#include "tree-check.h"
+
+using namespace std;
+
+// the aggregate of the items of ref with lo <= key <= hi, item by item
+template<typename Monoid, typename Value>
+typename Monoid::type bruteAggregate(const map<int, Value>& ref, int lo, int hi)
+{
+    typename Monoid::type result = Monoid::identity();
+    for(typename map<int, Value>::const_iterator it = ref.lower_bound(lo); it != ref.end() && it->first <= hi; ++it) {
+      result = Monoid::combine(result, Monoid::lift(it->first, it->second));
+    }
+    return result;
+}
+
+template<typename Monoid, typename Value>
+bool sameAggregates(const AggregateAVLTree<int, Value, Monoid>& tree, const map<int, Value>& ref,
+                    int keys, mt19937& rng)
+{
+    if(tree.aggregate() != bruteAggregate<Monoid>(ref, 0, keys)) return false;
+    for(int i = 0; i < 200; i++) {
+      int lo = rng() % (keys + 10) - 5;
+      int hi = lo + rng() % (keys / 4);
+      if(tree.aggregate(lo, hi) != bruteAggregate<Monoid>(ref, lo, hi)) return false;
+    }
+    return true;
+}
+
+// inserts, overwrites and removes through every update path that moves nodes
+template<typename Monoid, typename Value, typename MakeValue>
+void testMonoid(unsigned seed, MakeValue makeValue)
+{
+    AggregateAVLTree<int, Value, Monoid> tree;
+    map<int, Value> ref;
+    mt19937 rng(seed);
+    const int keys = 2000;
+    for(int round = 0; round < 20; round++) {
+      for(int i = 0; i < 500; i++) {
+        int key = rng() % keys;
+        if(rng() % 3) {
+          Value value = makeValue(rng());
+          tree.insert(make_pair(key, value));
+          ref[key] = value;
+        }
+        else {
+          tree.remove(key);
+          ref.erase(key);
+        }
+      }
+      CHECK(tree.isBalanced());
+      CHECK(sameItems(tree, ref));
+      CHECK(sameAggregates(tree, ref, keys, rng));
+
+      // range erase (split and join), pop_min/pop_max and node handles
+      int lo = rng() % keys;
+      tree.erase(tree.lower_bound(lo), tree.lower_bound(lo + 50));
+      ref.erase(ref.lower_bound(lo), ref.lower_bound(lo + 50));
+      if(!ref.empty()) {
+        tree.pop_min();
+        ref.erase(ref.begin());
+      }
+      if(!ref.empty()) {
+        tree.pop_max();
+        ref.erase(prev(ref.end()));
+      }
+      if(!ref.empty()) {
+        int key = ref.begin()->first;
+        typename AggregateAVLTree<int, Value, Monoid>::node_type handle = tree.extract(key);
+        tree.insert(std::move(handle));
+      }
+      CHECK(tree.isBalanced());
+      CHECK(sameItems(tree, ref));
+      CHECK(sameAggregates(tree, ref, keys, rng));
+    }
+
+    tree.rebalance();
+    CHECK(sameAggregates(tree, ref, keys, rng));
+
+    tree.setRelaxed(true, 0);
+    for(int i = 0; i < 1000; i++) {
+      Value value = makeValue(rng());
+      tree.insert(make_pair(keys + i, value));
+      ref[keys + i] = value;
+    }
+    CHECK(sameAggregates(tree, ref, keys + 1000, rng));
+    tree.finishRebalance();
+    CHECK(sameAggregates(tree, ref, keys + 1000, rng));
+}
+
+static int smallInt(unsigned r)
+{
+    return (int)(r % 2001) - 1000;
+}
+
+// string concatenation is not commutative, so it checks the key order
+static string letter(unsigned r)
+{
+    return string(1, (char)('a' + r % 26));
+}
+
+int main()
+{
+    testMonoid<SumAggregate<int>, int>(1, smallInt);
+    testMonoid<MinAggregate<int>, int>(2, smallInt);
+    testMonoid<MaxAggregate<int>, int>(3, smallInt);
+    testMonoid<CountAggregate, int>(4, smallInt);
+    testMonoid<SumAggregate<string>, string>(5, letter);
+
+    // an empty range or tree gives the identity
+    AggregateAVLTree<int, int, MinAggregate<int> > empty;
+    CHECK(empty.aggregate() == MinAggregate<int>::identity());
+    empty.insert(make_pair(5, 1));
+    CHECK(empty.aggregate(6, 10) == MinAggregate<int>::identity());
+    CHECK(empty.aggregate(5, 5) == 1);
+    return checkResult("aggregatebst-test");
+}
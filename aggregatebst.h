@@ -0,0 +1,317 @@
+#ifndef AGGREGATEBST_H
+#define AGGREGATEBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include "avlbst.h"
+
+/**
+* Monoids for AggregateAVLTree.  Each one names the aggregate type, its
+* identity, an associative combine (applied in key order, so it need not be
+* commutative) and lift, which turns one item into an aggregate.
+*/
+template <typename Value>
+struct SumAggregate
+{
+    typedef Value type;
+    static Value identity() { return Value(); }
+    static Value combine(const Value& a, const Value& b) { return a + b; }
+    template <typename Key>
+    static Value lift(const Key&, const Value& value) { return value; }
+};
+
+template <typename Value>
+struct MinAggregate
+{
+    typedef Value type;
+    static Value identity() { return std::numeric_limits<Value>::max(); }
+    static Value combine(const Value& a, const Value& b) { return std::min(a, b); }
+    template <typename Key>
+    static Value lift(const Key&, const Value& value) { return value; }
+};
+
+template <typename Value>
+struct MaxAggregate
+{
+    typedef Value type;
+    static Value identity() { return std::numeric_limits<Value>::lowest(); }
+    static Value combine(const Value& a, const Value& b) { return std::max(a, b); }
+    template <typename Key>
+    static Value lift(const Key&, const Value& value) { return value; }
+};
+
+struct CountAggregate
+{
+    typedef size_t type;
+    static size_t identity() { return 0; }
+    static size_t combine(size_t a, size_t b) { return a + b; }
+    template <typename Key, typename Value>
+    static size_t lift(const Key&, const Value&) { return 1; }
+};
+
+/**
+* An AVL node that also stores the aggregate of its whole subtree.
+*/
+template <typename Key, typename Value, typename Aggregate>
+class AggregateNode : public AVLNode<Key, Value>
+{
+public:
+    AggregateNode(const Key& key, const Value& value, AggregateNode<Key, Value, Aggregate>* parent,
+                  const Aggregate& aggregate);
+    virtual ~AggregateNode();
+    virtual AggregateNode<Key, Value, Aggregate>* clone() const override;
+
+    // Getter/setter for the subtree aggregate.
+    const Aggregate& getAggregate() const;
+    void setAggregate(const Aggregate& aggregate);
+
+    // Getters for parent, left, and right, returning AggregateNodes.
+    virtual AggregateNode<Key, Value, Aggregate>* getParent() const override;
+    virtual AggregateNode<Key, Value, Aggregate>* getLeft() const override;
+    virtual AggregateNode<Key, Value, Aggregate>* getRight() const override;
+
+protected:
+    Aggregate aggregate_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the AggregateNode class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value, class Aggregate>
+AggregateNode<Key, Value, Aggregate>::AggregateNode(const Key& key, const Value& value,
+                                                    AggregateNode<Key, Value, Aggregate>* parent,
+                                                    const Aggregate& aggregate) :
+    AVLNode<Key, Value>(key, value, parent), aggregate_(aggregate)
+{
+
+}
+
+template<class Key, class Value, class Aggregate>
+AggregateNode<Key, Value, Aggregate>::~AggregateNode()
+{
+
+}
+
+template<class Key, class Value, class Aggregate>
+AggregateNode<Key, Value, Aggregate>* AggregateNode<Key, Value, Aggregate>::clone() const
+{
+    return new AggregateNode<Key, Value, Aggregate>(*this);
+}
+
+template<class Key, class Value, class Aggregate>
+const Aggregate& AggregateNode<Key, Value, Aggregate>::getAggregate() const
+{
+    return aggregate_;
+}
+
+template<class Key, class Value, class Aggregate>
+void AggregateNode<Key, Value, Aggregate>::setAggregate(const Aggregate& aggregate)
+{
+    aggregate_ = aggregate;
+}
+
+template<class Key, class Value, class Aggregate>
+AggregateNode<Key, Value, Aggregate>* AggregateNode<Key, Value, Aggregate>::getParent() const
+{
+    return static_cast<AggregateNode<Key, Value, Aggregate>*>(this->parent_);
+}
+
+template<class Key, class Value, class Aggregate>
+AggregateNode<Key, Value, Aggregate>* AggregateNode<Key, Value, Aggregate>::getLeft() const
+{
+    return static_cast<AggregateNode<Key, Value, Aggregate>*>(this->left_);
+}
+
+template<class Key, class Value, class Aggregate>
+AggregateNode<Key, Value, Aggregate>* AggregateNode<Key, Value, Aggregate>::getRight() const
+{
+    return static_cast<AggregateNode<Key, Value, Aggregate>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the AggregateNode class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVL tree where every node keeps the Monoid aggregate of its subtree, so
+* the aggregate over any key range takes O(log n).  The aggregates are
+* refreshed along the update path (AVLTree::pathChanged) and by the rotations.
+* Values must be changed through insert(); writing through operator[] or an
+* iterator bypasses the aggregates.
+*/
+template <class Key, class Value, class Monoid, class Compare = std::less<Key> >
+class AggregateAVLTree : public AVLTree<Key, Value, Compare>
+{
+public:
+    typedef typename Monoid::type aggregate_type;
+
+    AggregateAVLTree();
+    explicit AggregateAVLTree(const Compare& comp);
+
+    // aggregate of the items with lo <= key <= hi, in key order
+    aggregate_type aggregate(const Key& lo, const Key& hi) const;
+    // aggregate of the whole tree
+    aggregate_type aggregate() const;
+
+protected:
+    typedef AggregateNode<Key, Value, aggregate_type> ANode;
+
+    virtual AVLNode<Key,Value>* createNode(const Key& key, const Value& value, AVLNode<Key,Value>* parent);
+    virtual void pathChanged(AVLNode<Key,Value>* n);
+    virtual void childrenChanged(AVLNode<Key,Value>* n);
+    virtual void rotateRight(AVLNode<Key,Value>* n);
+    virtual void rotateLeft(AVLNode<Key,Value>* n);
+    virtual bool isCompatibleNode(const Node<Key,Value>* n) const;
+    static aggregate_type subtreeAggregate(ANode* n);
+    static void recompute(ANode* n);
+    bool verifyAggregates(ANode* n) const;
+};
+
+template<class Key, class Value, class Monoid, class Compare>
+AggregateAVLTree<Key, Value, Monoid, Compare>::AggregateAVLTree()
+{
+
+}
+
+template<class Key, class Value, class Monoid, class Compare>
+AggregateAVLTree<Key, Value, Monoid, Compare>::AggregateAVLTree(const Compare& comp) :
+    AVLTree<Key, Value, Compare>(comp)
+{
+
+}
+
+template<class Key, class Value, class Monoid, class Compare>
+AVLNode<Key,Value>* AggregateAVLTree<Key, Value, Monoid, Compare>::createNode(const Key& key, const Value& value,
+                                                                             AVLNode<Key,Value>* parent)
+{
+    return new ANode(key, value, static_cast<ANode*>(parent), Monoid::lift(key, value));
+}
+
+// only nodes that carry an aggregate can be linked in
+template<class Key, class Value, class Monoid, class Compare>
+bool AggregateAVLTree<Key, Value, Monoid, Compare>::isCompatibleNode(const Node<Key,Value>* n) const
+{
+    return dynamic_cast<const ANode*>(n) != NULL;
+}
+
+// the aggregate of a possibly empty subtree
+template<class Key, class Value, class Monoid, class Compare>
+typename AggregateAVLTree<Key, Value, Monoid, Compare>::aggregate_type
+AggregateAVLTree<Key, Value, Monoid, Compare>::subtreeAggregate(ANode* n)
+{
+    return n ? n->getAggregate() : Monoid::identity();
+}
+
+// rebuilds n's aggregate from its children's
+template<class Key, class Value, class Monoid, class Compare>
+void AggregateAVLTree<Key, Value, Monoid, Compare>::recompute(ANode* n)
+{
+    n->setAggregate(Monoid::combine(subtreeAggregate(n->getLeft()),
+                    Monoid::combine(Monoid::lift(n->getKey(), n->getValue()),
+                                    subtreeAggregate(n->getRight()))));
+}
+
+template<class Key, class Value, class Monoid, class Compare>
+void AggregateAVLTree<Key, Value, Monoid, Compare>::pathChanged(AVLNode<Key,Value>* n)
+{
+    for(ANode* a = static_cast<ANode*>(n); a; a = a->getParent()) recompute(a);
+}
+
+template<class Key, class Value, class Monoid, class Compare>
+void AggregateAVLTree<Key, Value, Monoid, Compare>::childrenChanged(AVLNode<Key,Value>* n)
+{
+    recompute(static_cast<ANode*>(n));
+}
+
+// n moves down, so it is recomputed before its new parent
+template<class Key, class Value, class Monoid, class Compare>
+void AggregateAVLTree<Key, Value, Monoid, Compare>::rotateRight(AVLNode<Key,Value>* n)
+{
+    AVLTree<Key, Value, Compare>::rotateRight(n);
+    recompute(static_cast<ANode*>(n));
+    recompute(static_cast<ANode*>(n->getParent()));
+}
+
+template<class Key, class Value, class Monoid, class Compare>
+void AggregateAVLTree<Key, Value, Monoid, Compare>::rotateLeft(AVLNode<Key,Value>* n)
+{
+    AVLTree<Key, Value, Compare>::rotateLeft(n);
+    recompute(static_cast<ANode*>(n));
+    recompute(static_cast<ANode*>(n->getParent()));
+}
+
+template<class Key, class Value, class Monoid, class Compare>
+typename AggregateAVLTree<Key, Value, Monoid, Compare>::aggregate_type
+AggregateAVLTree<Key, Value, Monoid, Compare>::aggregate() const
+{
+    return subtreeAggregate(static_cast<ANode*>(this->root_));
+}
+
+/**
+* Finds the highest node inside [lo, hi], then walks down both sides of it
+* once: on the left every node >= lo contributes itself and its right
+* subtree, on the right every node <= hi contributes its left subtree and
+* itself.  Each walk is one root-to-leaf path, so this is O(log n).
+*/
+template<class Key, class Value, class Monoid, class Compare>
+typename AggregateAVLTree<Key, Value, Monoid, Compare>::aggregate_type
+AggregateAVLTree<Key, Value, Monoid, Compare>::aggregate(const Key& lo, const Key& hi) const
+{
+    ANode* split = static_cast<ANode*>(this->root_);
+    while(split) {
+      if(this->compareKeys(split->getKey(), lo) < 0) split = split->getRight();
+      else if(this->compareKeys(hi, split->getKey()) < 0) split = split->getLeft();
+      else break;
+    }
+    if(!split) return Monoid::identity();
+
+    // left walk visits keys in decreasing order, so it prepends
+    aggregate_type left = Monoid::identity();
+    for(ANode* n = split->getLeft(); n; ) {
+      if(this->compareKeys(n->getKey(), lo) < 0) {
+        n = n->getRight();
+      }
+      else {
+        left = Monoid::combine(Monoid::combine(Monoid::lift(n->getKey(), n->getValue()),
+                                               subtreeAggregate(n->getRight())), left);
+        n = n->getLeft();
+      }
+    }
+
+    // right walk visits keys in increasing order, so it appends
+    aggregate_type right = Monoid::identity();
+    for(ANode* n = split->getRight(); n; ) {
+      if(this->compareKeys(hi, n->getKey()) < 0) {
+        n = n->getLeft();
+      }
+      else {
+        right = Monoid::combine(right, Monoid::combine(subtreeAggregate(n->getLeft()),
+                                                       Monoid::lift(n->getKey(), n->getValue())));
+        n = n->getRight();
+      }
+    }
+
+    return Monoid::combine(left, Monoid::combine(Monoid::lift(split->getKey(), split->getValue()), right));
+}
+
+// true if every aggregate in the subtree matches its children
+template<class Key, class Value, class Monoid, class Compare>
+bool AggregateAVLTree<Key, Value, Monoid, Compare>::verifyAggregates(ANode* n) const
+{
+    if(!n) return true;
+    aggregate_type expected = Monoid::combine(subtreeAggregate(n->getLeft()),
+                              Monoid::combine(Monoid::lift(n->getKey(), n->getValue()),
+                                              subtreeAggregate(n->getRight())));
+    if(!(expected == n->getAggregate())) return false;
+    return verifyAggregates(n->getLeft()) && verifyAggregates(n->getRight());
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <map>
+#include <cmath>
+#include "avlbst.h"
+#include "tree-check.h"
+
+using namespace std;
+
+typedef AVLTree<int,int> Tree;
+
+// relaxed mode keeps the balances exact and marks what is out of balance
+static bool valid(const Tree& tree)
+{
+    return isSearchTree(tree) && tree.verifyStatistics();
+}
+
+// a finished tree is a plain AVL tree again
+static bool finished(Tree& tree)
+{
+    tree.finishRebalance();
+    return !tree.rebalancePending() && tree.isBalanced() && valid(tree) &&
+           tree.height() <= 1.4405 * log2(tree.size() + 2.0);
+}
+
+static void testRandomChurn()
+{
+    unsigned steps[] = { 0, 1, 3 };
+    for(int s = 0; s < 3; s++) {
+      Tree tree;
+      tree.setRelaxed(true, steps[s]);
+      map<int,int> ref;
+      churn(tree, ref, 1 + s, 20000, 2000, valid);
+      churn(tree, ref, 11 + s, 5000, 40, valid);
+      CHECK(finished(tree));
+      CHECK(sameItems(tree, ref));
+    }
+}
+
+static void testDeferredWork()
+{
+    // with no steps per update a sorted run leaves the work pending
+    Tree tree;
+    tree.setRelaxed(true, 0);
+    map<int,int> ref;
+    for(int i = 0; i < 3000; i++) {
+      tree.insert(make_pair(i, i));
+      ref[i] = i;
+    }
+    CHECK(tree.isRelaxed());
+    CHECK(tree.rebalancePending());
+    CHECK(valid(tree));
+    // no write drained the backlog, even with balances far past [-1, 1]
+    CHECK(tree.height() == 3000);
+
+    // bounded steps make progress and never overshoot
+    size_t total = 0;
+    for(;;) {
+      size_t done = tree.rebalanceSteps(16);
+      CHECK(done <= 16);
+      total += done;
+      if(done < 16) break;
+      CHECK(valid(tree));
+    }
+    CHECK(total > 0);
+    CHECK(finished(tree));
+    CHECK(sameItems(tree, ref));
+    CHECK(tree.rebalanceSteps(16) == 0);
+
+    // turning relaxed mode off finishes pending removals too
+    for(int i = 0; i < 3000; i += 2) {
+      tree.remove(i);
+      ref.erase(i);
+    }
+    CHECK(valid(tree));
+    tree.setRelaxed(false);
+    CHECK(!tree.isRelaxed() && !tree.rebalancePending());
+    CHECK(tree.isBalanced() && valid(tree));
+    CHECK(sameItems(tree, ref));
+
+    // and eager updates carry on from there
+    churn(tree, ref, 21, 5000, 3000, finished);
+}
+
+// height() only reads the cached value, so every kind of update must keep it
+static void testHeightCache()
+{
+    for(unsigned steps = 0; steps < 3; steps++) {
+      Tree tree, other;
+      if(steps) tree.setRelaxed(true, steps - 1);
+      bool ok = true;
+      for(int i = 0; i < 4000; i++) {
+        tree.insert(make_pair((i * 7919) % 4000, i));
+        if(i % 3 == 0) tree.remove((i * 31) % 4000);
+        if(i % 500 == 499) {
+          Tree::iterator first = tree.lower_bound(i % 1000);
+          tree.erase(first, tree.lower_bound(i % 1000 + 300));
+        }
+        if(i % 700 == 0) tree.swap(other);
+        ok = ok && tree.height() == subtreeHeight(tree.rootNode()) &&
+             other.height() == subtreeHeight(other.rootNode());
+      }
+      CHECK(ok);
+      if(steps) tree.rebalanceSteps(100);
+      CHECK(tree.height() == subtreeHeight(tree.rootNode()));
+      tree.rebalance();
+      CHECK(tree.height() == subtreeHeight(tree.rootNode()));
+      tree.clear();
+      CHECK(tree.height() == 0);
+      tree.insert(make_pair(1, 1));
+      CHECK(tree.height() == 1);
+    }
+}
+
+int main()
+{
+    testRandomChurn();
+    testDeferredWork();
+    testHeightCache();
+    return checkResult("avlbst-relaxed-test");
+}
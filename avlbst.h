@@ -7,7 +7,10 @@
 #include <cstdint>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <vector>
 #include "bst.h"
+#include "work-stealing-pool.h"
 
 struct KeyError { };
 
@@ -23,11 +26,17 @@ public:
     // Constructor/destructor.
     AVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
     virtual ~AVLNode();
+    virtual AVLNode<Key, Value>* clone() const override;
 
     // Getter/setter for the node's height.
-    int8_t getBalance () const;
-    void setBalance (int8_t balance);
-    void updateBalance(int8_t diff);
+    int32_t getBalance () const;
+    void setBalance (int32_t balance);
+    void updateBalance(int32_t diff);
+
+    // Getter/setter for the relaxed-mode flag: set on nodes that are out of
+    // balance and on all their ancestors.
+    bool isPending() const;
+    void setPending(bool pending);
 
     // Getters for parent, left, and right. These need to be redefined since they
     // return pointers to AVLNodes - not plain Nodes. See the Node class in bst.h
@@ -37,7 +46,10 @@ public:
     virtual AVLNode<Key, Value>* getRight() const override;
 
 protected:
-    int8_t balance_;    // effectively a signed char
+    // eager updates keep it in [-1, 1]; relaxed mode with deferred
+    // rebalancing can build up imbalances as large as the tree is tall
+    int32_t balance_;
+    bool pending_;
 };
 
 /*
@@ -51,7 +63,7 @@ protected:
 */
 template<class Key, class Value>
 AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
-    Node<Key, Value>(key, value, parent), balance_(0)
+    Node<Key, Value>(key, value, parent), balance_(0), pending_(false)
 {
 
 }
@@ -65,11 +77,17 @@ AVLNode<Key, Value>::~AVLNode()
 
 }
 
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLNode<Key, Value>::clone() const
+{
+    return new AVLNode<Key, Value>(*this);
+}
+
 /**
 * A getter for the balance of a AVLNode.
 */
 template<class Key, class Value>
-int8_t AVLNode<Key, Value>::getBalance() const
+int32_t AVLNode<Key, Value>::getBalance() const
 {
     return balance_;
 }
@@ -78,7 +96,7 @@ int8_t AVLNode<Key, Value>::getBalance() const
 * A setter for the balance of a AVLNode.
 */
 template<class Key, class Value>
-void AVLNode<Key, Value>::setBalance(int8_t balance)
+void AVLNode<Key, Value>::setBalance(int32_t balance)
 {
     balance_ = balance;
 }
@@ -87,11 +105,29 @@ void AVLNode<Key, Value>::setBalance(int8_t balance)
 * Adds diff to the balance of a AVLNode.
 */
 template<class Key, class Value>
-void AVLNode<Key, Value>::updateBalance(int8_t diff)
+void AVLNode<Key, Value>::updateBalance(int32_t diff)
 {
     balance_ += diff;
 }
 
+/**
+* A getter for the pending flag of a AVLNode.
+*/
+template<class Key, class Value>
+bool AVLNode<Key, Value>::isPending() const
+{
+    return pending_;
+}
+
+/**
+* A setter for the pending flag of a AVLNode.
+*/
+template<class Key, class Value>
+void AVLNode<Key, Value>::setPending(bool pending)
+{
+    pending_ = pending;
+}
+
 /**
 * An overridden function for getting the parent since a static_cast is necessary to make sure
 * that our node is a AVLNode.
@@ -128,12 +164,57 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 */
 
 
-template <class Key, class Value>
-class AVLTree : public BinarySearchTree<Key, Value>
+/**
+* An AVL tree.  By default every insert and remove rebalances eagerly.
+*
+* In relaxed mode (setRelaxed) updates only keep the balance factors exact and
+* mark the nodes that went out of balance; no rotations happen on the update
+* path.  The marked nodes are repaired later, one rotation per step, either
+* stepsPerUpdate steps after each update or explicitly through
+* rebalanceSteps() / finishRebalance() (e.g. when a write burst is over).
+* An update never does more than its stepsPerUpdate steps, so a relaxed write
+* costs O(log n + stepsPerUpdate * height) however much work is pending.
+* Once nothing is pending the tree is a regular AVL tree again.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class AVLTree : public BinarySearchTree<Key, Value, Compare>
 {
 public:
-    virtual void insert (const std::pair<const Key, Value> &keyValuePair); // TODO
-    virtual void remove(const Key& key);  // TODO
+    typedef typename BinarySearchTree<Key, Value, Compare>::iterator iterator;
+
+    AVLTree();
+    explicit AVLTree(const Compare& comp);
+    AVLTree(const AVLTree& other);
+    AVLTree(AVLTree&& other);
+    AVLTree& operator=(const AVLTree& other);
+    AVLTree& operator=(AVLTree&& other);
+    virtual void insert (const std::pair<const Key, Value> &keyValuePair);
+    virtual void remove(const Key& key);
+    using BinarySearchTree<Key, Value, Compare>::insert;
+    void swap(AVLTree& other);
+
+    // Relaxed-balance mode.  Turning it off finishes all pending work first.
+    void setRelaxed(bool relaxed, unsigned stepsPerUpdate = 1);
+    bool isRelaxed() const;
+    size_t rebalanceSteps(size_t maxSteps);
+    void finishRebalance();
+    bool rebalancePending() const;
+    virtual void rebalance();
+
+    // O(1) statistics: size and balance come from the maintained counts and
+    // balances, the height is kept up to date by every update
+    int height() const;
+    virtual bool isBalanced() const;
+    // Opt-in full check, O(n): recounts and re-measures the whole tree and
+    // compares the results with the cached statistics and every balance
+    bool verifyStatistics() const;
+    // Parallel O(n) check of key order, parent links, balances, size and
+    // height, with subtrees spread over pool.  Returns NULL for a valid tree,
+    // otherwise a description of the first violation found; where (if given)
+    // is set to the offending node, or end() for the tree as a whole.
+    const char* verifyParallel(WorkStealingPool& pool, iterator* where = NULL) const;
+    // the root as an AVLNode, so analysis passes see the balances
+    const AVLNode<Key,Value>* rootNode() const;
 protected:
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
     virtual void insertFix(AVLNode<Key,Value>* p, AVLNode<Key,Value>* n); 
@@ -141,70 +222,249 @@ protected:
     virtual void rotateRight (AVLNode<Key,Value>* n); 
     virtual void rotateLeft (AVLNode<Key,Value>* n); 
     virtual int height(AVLNode<Key,Value>* n);
+    AVLNode<Key,Value>* insertLeaf(AVLNode<Key,Value>* parent, bool left, const std::pair<const Key, Value> &keyValuePair);
+    AVLNode<Key,Value>* linkLeaf(AVLNode<Key,Value>* parent, bool left, AVLNode<Key,Value>* current);
+    virtual Node<Key,Value>* detachNode(Node<Key,Value>* n);
+    virtual Node<Key,Value>* attachNode(Node<Key,Value>* n);
+    virtual bool isCompatibleNode(const Node<Key,Value>* n) const;
+    virtual void eraseRange(Node<Key,Value>* first, Node<Key,Value>* last);
+    virtual void cleared();
+    virtual void splitAround(Node<Key,Value>* x, Node<Key,Value>*& lo, Node<Key,Value>*& hi);
+    virtual Node<Key,Value>* joinAround(Node<Key,Value>* lo, Node<Key,Value>* k, Node<Key,Value>* hi);
+    AVLNode<Key,Value>* join(AVLNode<Key,Value>* lo, int hLo, AVLNode<Key,Value>* k,
+                             AVLNode<Key,Value>* hi, int hHi, int& h);
+    AVLNode<Key,Value>* joinFixLeft(AVLNode<Key,Value>* n, int hLeft, int hRight, int& h);
+    AVLNode<Key,Value>* joinFixRight(AVLNode<Key,Value>* n, int hLeft, int hRight, int& h);
+    static int spineHeight(AVLNode<Key,Value>* n);
+    virtual AVLNode<Key,Value>* createNode(const Key& key, const Value& value, AVLNode<Key,Value>* parent);
+    virtual void pathChanged(AVLNode<Key,Value>* n);
+    virtual void childrenChanged(AVLNode<Key,Value>* n);
     virtual bool verifyBalances(AVLNode<Key,Value>* n);  
+    int resetBalances(AVLNode<Key,Value>* n);
+    static bool pendingBalanced(AVLNode<Key,Value>* n);
+    static int verifySubtree(AVLNode<Key,Value>* n, size_t& count, bool& ok);
+
+    // per-subtree results of verifyParallel
+    struct VerifyResult
+    {
+        int height;
+        size_t count;
+        const char* what;
+        AVLNode<Key,Value>* where;
+        // gave up early because another part failed
+        bool stopped;
+    };
+    struct VerifyFrame
+    {
+        AVLNode<Key,Value>* n;
+        AVLNode<Key,Value>* lo;
+        AVLNode<Key,Value>* hi;
+        int leftHeight;
+        int state;
+    };
+    void verifyPart(AVLNode<Key,Value>* n, AVLNode<Key,Value>* lo, AVLNode<Key,Value>* hi, int splitDepth,
+                    WorkStealingPool& pool, std::atomic<bool>& failed, VerifyResult& out) const;
+    void verifySequential(AVLNode<Key,Value>* n, AVLNode<Key,Value>* lo, AVLNode<Key,Value>* hi,
+                          std::atomic<bool>& failed, VerifyResult& out) const;
+    const char* verifyNode(AVLNode<Key,Value>* n, AVLNode<Key,Value>* lo, AVLNode<Key,Value>* hi) const;
+    static const char* verifyShape(AVLNode<Key,Value>* n, int leftHeight, int rightHeight);
+    virtual bool uniqueKeys() const;
     // Add helper functions here
-
+    void retrace(AVLNode<Key,Value>* n, bool left, int delta);
+    void markPending(AVLNode<Key,Value>* n);
+    void relaxedUpdateDone();
+    AVLNode<Key,Value>* rebalanceStep(AVLNode<Key,Value>* n);
+    int relaxedRotateLeft(AVLNode<Key,Value>* n);
+    int relaxedRotateRight(AVLNode<Key,Value>* n);
+
+    bool relaxed_;
+    unsigned stepsPerUpdate_;
+    // tree height, kept exact by every update that reaches the root
+    int height_;
 
 };
 
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree() :
+    relaxed_(false),
+    stepsPerUpdate_(0),
+    height_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp),
+    relaxed_(false),
+    stepsPerUpdate_(0),
+    height_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree(const AVLTree& other) :
+    BinarySearchTree<Key, Value, Compare>(other),
+    relaxed_(other.relaxed_),
+    stepsPerUpdate_(other.stepsPerUpdate_),
+    height_(other.height_)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree(AVLTree&& other) :
+    BinarySearchTree<Key, Value, Compare>(std::move(other)),
+    relaxed_(other.relaxed_),
+    stepsPerUpdate_(other.stepsPerUpdate_),
+    height_(other.height_)
+{
+    other.height_ = 0;
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>&
+AVLTree<Key, Value, Compare>::operator=(const AVLTree& other)
+{
+    if(this != &other) {
+      BinarySearchTree<Key, Value, Compare>::operator=(other);
+      relaxed_ = other.relaxed_;
+      stepsPerUpdate_ = other.stepsPerUpdate_;
+      height_ = other.height_;
+    }
+    return *this;
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>&
+AVLTree<Key, Value, Compare>::operator=(AVLTree&& other)
+{
+    if(this != &other) {
+      BinarySearchTree<Key, Value, Compare>::operator=(std::move(other));
+      relaxed_ = other.relaxed_;
+      stepsPerUpdate_ = other.stepsPerUpdate_;
+      height_ = other.height_;
+      other.height_ = 0;
+    }
+    return *this;
+}
+
+/**
+* Exchanges two trees in O(1).  The relaxed-mode settings go along with the
+* nodes, since pending nodes need relaxed mode to be finished.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::swap(AVLTree& other)
+{
+    BinarySearchTree<Key, Value, Compare>::swap(other);
+    std::swap(relaxed_, other.relaxed_);
+    std::swap(stepsPerUpdate_, other.stepsPerUpdate_);
+    std::swap(height_, other.height_);
+}
+
 /*
  * Recall: If key is already in the tree, you should 
  * overwrite the current value with the updated value.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &keyValuePair)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &keyValuePair)
 { 
 
-    AVLNode<Key, Value>* current = dynamic_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key,Value>::root_); 
+    AVLNode<Key, Value>* current = dynamic_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_); 
     AVLNode<Key, Value>* parent = nullptr; 
+    int c = 0; 
+    KeyProbe<Key, Compare, Key> probe(this->comp_, keyValuePair.first); 
 
-    while(current && (current->getKey() != keyValuePair.first)) {
-      if(keyValuePair.first < current->getKey()) {
-        parent = current; 
+    while(current && (c = probe.compare(current)) != 0) {
+      parent = current; 
+      if(c < 0)
         current = current->getLeft(); 
-      } else if(keyValuePair.first > current->getKey()) {
-        parent = current; 
+      else
         current = current->getRight(); 
-
-      }
     }
 
     // check if current is null, which means new node
     if(!current) {
-      current = new AVLNode<Key, Value>(keyValuePair.first, keyValuePair.second, parent); 
-      // check if parent is null, if it is then update root
-      if(!parent) BinarySearchTree<Key,Value>::root_ = current; 
-      // check if its a right or left link with parent
-      else if(current->getKey() < parent->getKey())
-        parent->setLeft(current); 
-      else  
-        parent->setRight(current); 
-
-      // AVL updates
-      // if node has a parent, update balances
-      if(parent) {
-        // if parent's balance is -1 or 1, update parent's balance to 0
-        if(parent->getBalance()) {
-          parent->setBalance(0);
-        } 
-        // if parent's balance is 0, update balance and call insert-fix to rebalance
-        // if current is left child, parent balance is -1; right child, parent balance is +1
-        else if(parent->getBalance() == 0) {
-          parent->setBalance((parent->getLeft() == current) ? -1 : 1); 
-          insertFix(parent, current); 
-        }
-      }
+      insertLeaf(parent, c < 0, keyValuePair); 
     }
 
     // otherwise current should have same key as keyValuePair
-    else if(current->getKey() == keyValuePair.first)
+    else {
       current->setValue(keyValuePair.second); 
+      pathChanged(current); 
+    }
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::insertFix(AVLNode<Key,Value>* p, AVLNode<Key,Value>* n) {
+/**
+* Links a new node for keyValuePair in as the left or right child of parent
+* (or as the root if parent is NULL) and rebalances.  Returns the new node.
+* precondition: that child slot is empty and the key belongs there
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key,Value>* AVLTree<Key, Value, Compare>::insertLeaf(AVLNode<Key,Value>* parent, bool left,
+                                                           const std::pair<const Key, Value> &keyValuePair)
+{
+    return linkLeaf(parent, left, createNode(keyValuePair.first, keyValuePair.second, parent)); 
+}
+
+/**
+* Links the childless node current in like insertLeaf does.  Its balance and
+* pending flag are reset, so a node detached from another tree can be reused.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key,Value>* AVLTree<Key, Value, Compare>::linkLeaf(AVLNode<Key,Value>* parent, bool left,
+                                                         AVLNode<Key,Value>* current)
+{
+    current->setParent(parent); 
+    current->setBalance(0); 
+    current->setPending(false); 
+    // check if parent is null, if it is then update root
+    if(!parent) {
+      BinarySearchTree<Key, Value, Compare>::root_ = current; 
+      height_ = 1; 
+    }
+    // check if its a right or left link with parent
+    else if(left)
+      parent->setLeft(current); 
+    else  
+      parent->setRight(current); 
+    this->leafLinked(current); 
+    pathChanged(current); 
+
+    // relaxed mode: only record the height change
+    if(relaxed_) {
+      if(parent) retrace(parent, left, 1);
+      relaxedUpdateDone();
+      return current;
+    }
+
+    // AVL updates
+    // if node has a parent, update balances
+    if(parent) {
+      // if parent's balance is -1 or 1, update parent's balance to 0
+      if(parent->getBalance()) {
+        parent->setBalance(0);
+      } 
+      // if parent's balance is 0, update balance and call insert-fix to rebalance
+      // if current is left child, parent balance is -1; right child, parent balance is +1
+      else if(parent->getBalance() == 0) {
+        parent->setBalance(left ? -1 : 1); 
+        insertFix(parent, current); 
+      }
+    }
+    return current; 
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::insertFix(AVLNode<Key,Value>* p, AVLNode<Key,Value>* n) {
  
-  if(!p || !p->getParent()) return; 
+  if(!p) return; 
+  // p's subtree grew; if p is the root, so did the tree
+  if(!p->getParent()) {
+    height_++; 
+    return; 
+  }
 
   AVLNode<Key, Value>* g = p->getParent();  
 
@@ -279,28 +539,35 @@ void AVLTree<Key, Value>::insertFix(AVLNode<Key,Value>* p, AVLNode<Key,Value>* n
  * Recall: The writeup specifies that if a node has 2 children you
  * should swap with the predecessor and then remove.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>:: remove(const Key& key)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>:: remove(const Key& key)
 { 
 
 
-    AVLNode<Key,Value>* current = dynamic_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key,Value>::root_); 
-    while(current && current->getKey() != key) {
-      if(key < current->getKey())
-        current = current->getLeft(); 
-      else if(key > current->getKey())
-        current = current->getRight();   
-    }
+    Node<Key,Value>* current = this->internalFind(key); 
 
     // CASE 1: There is no node with the desired key to be removed
     if(!current) return;
 
+    // free memory of current node
+    delete detachNode(current); 
+}
+
+/**
+* Unlinks n and rebalances without freeing it.
+*/
+template<class Key, class Value, class Compare>
+Node<Key,Value>* AVLTree<Key, Value, Compare>::detachNode(Node<Key,Value>* n)
+{
+    AVLNode<Key,Value>* current = static_cast<AVLNode<Key,Value>*>(n); 
+    this->nodeLeaving(current); 
+
       // removes current node
     // CASE 1: 2 Children (Swaps current with predecessor)
     if(current->getLeft() && current->getRight()) {
       // std::cout << "value of root " << root_->getValue() << std::endl; 
       // std::cout << "predecessor of " << current->getValue() << " is " << predecessor(current)->getValue() << std::endl; 
-      nodeSwap(current, dynamic_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key,Value>::predecessor(current))); 
+      nodeSwap(current, dynamic_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::predecessor(current))); 
       // std::cout << "tree after swapping with predecessor" << std::endl; 
       // std::cout << "value of root " << root_->getValue() << std::endl; 
       // this->print(); 
@@ -310,21 +577,22 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 
     int ndiff = 0; 
 
-    // CASE 2: Node is ROOT
-    if(current == BinarySearchTree<Key,Value>::root_) {
+    // CASE 2: Node is ROOT (its one subtree, if any, is one shorter)
+    if(current == BinarySearchTree<Key, Value, Compare>::root_) {
+      height_--; 
       // CASE 2A: only left child
       if(current->getLeft()) {
         current->getLeft()->setParent(nullptr); 
-        BinarySearchTree<Key,Value>::root_ = current->getLeft(); 
+        BinarySearchTree<Key, Value, Compare>::root_ = current->getLeft(); 
       }
       // CASE 2B: only right child
       else if(current->getRight()) {
         current->getRight()->setParent(nullptr);
-        BinarySearchTree<Key,Value>::root_ = current->getRight(); 
+        BinarySearchTree<Key, Value, Compare>::root_ = current->getRight(); 
       }
       // CASE 2C: no child
       else {
-        BinarySearchTree<Key,Value>::root_ = nullptr; 
+        BinarySearchTree<Key, Value, Compare>::root_ = nullptr; 
       }
     }
 
@@ -381,22 +649,311 @@ void AVLTree<Key, Value>:: remove(const Key& key)
     // access parent of removed node to start rebalancing tree
     AVLNode<Key,Value>* parent = current->getParent(); 
 
-    // free memory of current node
-    delete current;  
+    if(parent) pathChanged(parent); 
+
+    // relaxed mode: the parent's subtree on the removed side got shorter by one
+    if(relaxed_) {
+      if(parent) retrace(parent, ndiff == 1, -1);
+      relaxedUpdateDone();
+      return current;
+    }
 
     // call removeFix to rebalance tree
     if(parent)
       removeFix(parent, ndiff); 
 
+    return current; 
+}
+
+/*
+ * Recall: If key is already in the tree, you should 
+ * overwrite the current value with the updated value (and free n).
+ */
+template<class Key, class Value, class Compare>
+Node<Key,Value>* AVLTree<Key, Value, Compare>::attachNode(Node<Key,Value>* n)
+{
+    Node<Key,Value>* parent; 
+    int c; 
+    AVLNode<Key,Value>* current = static_cast<AVLNode<Key,Value>*>(this->descend(n->getKey(), parent, c)); 
+
+    if(current) {
+      current->setValue(n->getValue()); 
+      delete n; 
+      pathChanged(current); 
+      return current; 
+    }
+    return linkLeaf(static_cast<AVLNode<Key,Value>*>(parent), c < 0, static_cast<AVLNode<Key,Value>*>(n)); 
+}
+
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::isCompatibleNode(const Node<Key,Value>* n) const
+{
+    return dynamic_cast<const AVLNode<Key,Value>*>(n) != NULL; 
+}
+
+/**
+* Rebuilds the tree with BinarySearchTree::rebalance, whose plain rotations
+* leave the balances stale, then recomputes them bottom-up.  A complete tree
+* is a valid AVL tree, so this also clears any relaxed-mode pending work.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::rebalance()
+{
+    BinarySearchTree<Key, Value, Compare>::rebalance(); 
+    height_ = resetBalances(static_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_)); 
+}
+
+// sets every balance in the subtree from scratch and returns its height;
+// the recursion is only as deep as the freshly rebuilt tree
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::resetBalances(AVLNode<Key,Value>* n)
+{
+    if(!n) return 0; 
+    int left = resetBalances(n->getLeft()); 
+    int right = resetBalances(n->getRight()); 
+    n->setBalance(right - left); 
+    n->setPending(false); 
+    childrenChanged(n); 
+    return 1 + std::max(left, right); 
+}
+
+/**
+* Range removal through split and join, which keep the AVL shape; see
+* BinarySearchTree::eraseRange.  Both need exact balances, so relaxed mode
+* finishes its pending work first.  The joined tree's height is read off its
+* balances, an O(log n) walk that is within the cost of the split.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::eraseRange(Node<Key,Value>* first, Node<Key,Value>* last)
+{
+    if(relaxed_) finishRebalance(); 
+    BinarySearchTree<Key, Value, Compare>::eraseRange(first, last); 
+    height_ = spineHeight(static_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_)); 
+}
+
+// clear() empties the tree through the base class
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::cleared()
+{
+    height_ = 0; 
+}
+
+// height of the subtree at n, found by always stepping into the taller child
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::spineHeight(AVLNode<Key,Value>* n)
+{
+    int h = 0; 
+    while(n) {
+      h++; 
+      n = (n->getBalance() > 0) ? n->getRight() : n->getLeft(); 
+    }
+    return h; 
+}
+
+/**
+* Splits the tree holding x into AVL trees of the items before and after x.
+* Walking up from x, each ancestor is joined with its other subtree onto
+* the matching side.  Heights come from the balances on the way, and each
+* join costs the height difference of its inputs, which telescopes, so the
+* split takes O(log n).
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::splitAround(Node<Key,Value>* node, Node<Key,Value>*& lo, Node<Key,Value>*& hi)
+{
+    AVLNode<Key,Value>* x = static_cast<AVLNode<Key,Value>*>(node); 
+    int h = spineHeight(x); 
+    int b = x->getBalance(); 
+    int hLo = (b > 0) ? h - 2 : h - 1; 
+    int hHi = (b < 0) ? h - 2 : h - 1; 
+    AVLNode<Key,Value>* left = x->getLeft(); 
+    AVLNode<Key,Value>* right = x->getRight(); 
+    if(left) left->setParent(nullptr); 
+    if(right) right->setParent(nullptr); 
+
+    AVLNode<Key,Value>* child = x; 
+    AVLNode<Key,Value>* a = x->getParent(); 
+    while(a) {
+      AVLNode<Key,Value>* next = a->getParent(); 
+      b = a->getBalance(); 
+      // CASE 1: we came up from the left, so a and its right subtree follow x
+      if(a->getLeft() == child) {
+        AVLNode<Key,Value>* sibling = a->getRight(); 
+        int hSibling = h + b; 
+        if(sibling) sibling->setParent(nullptr); 
+        h = 1 + std::max(h, hSibling); 
+        right = join(right, hHi, a, sibling, hSibling, hHi); 
+      }
+      // CASE 2: we came up from the right, so a and its left subtree precede x
+      else {
+        AVLNode<Key,Value>* sibling = a->getLeft(); 
+        int hSibling = h - b; 
+        if(sibling) sibling->setParent(nullptr); 
+        h = 1 + std::max(h, hSibling); 
+        left = join(sibling, hSibling, a, left, hLo, hLo); 
+      }
+      child = a; 
+      a = next; 
+    }
+    lo = left; 
+    hi = right; 
+}
+
+template<class Key, class Value, class Compare>
+Node<Key,Value>* AVLTree<Key, Value, Compare>::joinAround(Node<Key,Value>* lo, Node<Key,Value>* k, Node<Key,Value>* hi)
+{
+    AVLNode<Key,Value>* l = static_cast<AVLNode<Key,Value>*>(lo); 
+    AVLNode<Key,Value>* r = static_cast<AVLNode<Key,Value>*>(hi); 
+    int h; 
+    return join(l, spineHeight(l), static_cast<AVLNode<Key,Value>*>(k), r, spineHeight(r), h); 
+}
+
+/**
+* Joins the AVL trees lo (height hLo) and hi (height hHi) with k between
+* them and returns the root of the result, whose height goes to h.  k hangs
+* from the spine of the taller tree where the heights meet, and only that
+* spine is rebalanced on the way back up: O(|hLo - hHi| + 1).
+* precondition: lo and hi have no parent; keys in lo < k < keys in hi
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key,Value>* AVLTree<Key, Value, Compare>::join(AVLNode<Key,Value>* lo, int hLo, AVLNode<Key,Value>* k,
+                                                      AVLNode<Key,Value>* hi, int hHi, int& h)
+{
+    // CASE 1: lo is taller, descend its right spine
+    if(hLo > hHi + 1) {
+      int b = lo->getBalance(); 
+      int hLeft = (b > 0) ? hLo - 2 : hLo - 1; 
+      int hRight = (b < 0) ? hLo - 2 : hLo - 1; 
+      AVLNode<Key,Value>* right = lo->getRight(); 
+      if(right) right->setParent(nullptr); 
+      right = join(right, hRight, k, hi, hHi, hRight); 
+      lo->setRight(right); 
+      right->setParent(lo); 
+      return joinFixRight(lo, hLeft, hRight, h); 
+    }
+    // CASE 2: hi is taller, descend its left spine
+    if(hHi > hLo + 1) {
+      int b = hi->getBalance(); 
+      int hLeft = (b > 0) ? hHi - 2 : hHi - 1; 
+      int hRight = (b < 0) ? hHi - 2 : hHi - 1; 
+      AVLNode<Key,Value>* left = hi->getLeft(); 
+      if(left) left->setParent(nullptr); 
+      left = join(lo, hLo, k, left, hLeft, hLeft); 
+      hi->setLeft(left); 
+      left->setParent(hi); 
+      return joinFixLeft(hi, hLeft, hRight, h); 
+    }
+    // CASE 3: heights within one, k becomes the root
+    k->setParent(nullptr); 
+    k->setLeft(lo); 
+    k->setRight(hi); 
+    if(lo) lo->setParent(k); 
+    if(hi) hi->setParent(k); 
+    k->setBalance(hHi - hLo); 
+    k->setPending(false); 
+    childrenChanged(k); 
+    h = 1 + std::max(hLo, hHi); 
+    return k; 
+}
+
+/**
+* n's right subtree was replaced by one of height hRight, at most 2 taller
+* than its left (height hLeft).  Restores the balance at n and returns the
+* subtree's new root; h receives its height.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key,Value>* AVLTree<Key, Value, Compare>::joinFixRight(AVLNode<Key,Value>* n, int hLeft, int hRight, int& h)
+{
+    // CASE 1: still balanced
+    if(hRight - hLeft <= 1) {
+      n->setBalance(hRight - hLeft); 
+      childrenChanged(n); 
+      h = 1 + std::max(hLeft, hRight); 
+      return n; 
+    }
+
+    AVLNode<Key,Value>* r = n->getRight(); 
+    int b = r->getBalance(); 
+    int hInner = (b > 0) ? hRight - 2 : hRight - 1; 
+    int hOuter = (b < 0) ? hRight - 2 : hRight - 1; 
 
+    // CASE 2: ZIG-ZIG, single rotation
+    if(hOuter >= hInner) {
+      rotateLeft(n); 
+      n->setBalance(hInner - hLeft); 
+      int hN = 1 + std::max(hLeft, hInner); 
+      r->setBalance(hOuter - hN); 
+      h = 1 + std::max(hN, hOuter); 
+      return r; 
+    }
+
+    // CASE 3: ZIG-ZAG, double rotation through r's left child
+    AVLNode<Key,Value>* m = r->getLeft(); 
+    int bm = m->getBalance(); 
+    int hmLeft = (bm > 0) ? hInner - 2 : hInner - 1; 
+    int hmRight = (bm < 0) ? hInner - 2 : hInner - 1; 
+    rotateRight(r); 
+    rotateLeft(n); 
+    n->setBalance(hmLeft - hLeft); 
+    r->setBalance(hOuter - hmRight); 
+    int hN = 1 + std::max(hLeft, hmLeft); 
+    int hR = 1 + std::max(hmRight, hOuter); 
+    m->setBalance(hR - hN); 
+    h = 1 + std::max(hN, hR); 
+    return m; 
+}
+
+// mirror image of joinFixRight
+template<class Key, class Value, class Compare>
+AVLNode<Key,Value>* AVLTree<Key, Value, Compare>::joinFixLeft(AVLNode<Key,Value>* n, int hLeft, int hRight, int& h)
+{
+    // CASE 1: still balanced
+    if(hLeft - hRight <= 1) {
+      n->setBalance(hRight - hLeft); 
+      childrenChanged(n); 
+      h = 1 + std::max(hLeft, hRight); 
+      return n; 
+    }
+
+    AVLNode<Key,Value>* l = n->getLeft(); 
+    int b = l->getBalance(); 
+    int hInner = (b < 0) ? hLeft - 2 : hLeft - 1; 
+    int hOuter = (b > 0) ? hLeft - 2 : hLeft - 1; 
+
+    // CASE 2: ZIG-ZIG, single rotation
+    if(hOuter >= hInner) {
+      rotateRight(n); 
+      n->setBalance(hRight - hInner); 
+      int hN = 1 + std::max(hInner, hRight); 
+      l->setBalance(hN - hOuter); 
+      h = 1 + std::max(hN, hOuter); 
+      return l; 
+    }
+
+    // CASE 3: ZIG-ZAG, double rotation through l's right child
+    AVLNode<Key,Value>* m = l->getRight(); 
+    int bm = m->getBalance(); 
+    int hmLeft = (bm > 0) ? hInner - 2 : hInner - 1; 
+    int hmRight = (bm < 0) ? hInner - 2 : hInner - 1; 
+    rotateLeft(l); 
+    rotateRight(n); 
+    n->setBalance(hRight - hmRight); 
+    l->setBalance(hmLeft - hOuter); 
+    int hN = 1 + std::max(hmRight, hRight); 
+    int hL = 1 + std::max(hOuter, hmLeft); 
+    m->setBalance(hN - hL); 
+    h = 1 + std::max(hL, hN); 
+    return m; 
 }
 
 // patch tree after removal
-template<class Key, class Value>
-void AVLTree<Key,Value>::removeFix(AVLNode<Key,Value>* n, int diff) {
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::removeFix(AVLNode<Key,Value>* n, int diff) {
 
-  // CASE 1: Current node is null
-  if(!n) return; 
+  // CASE 1: walked up past the root, so the whole tree got shorter
+  if(!n) {
+    height_--; 
+    return; 
+  }
 
   AVLNode<Key,Value>* p = n->getParent(); 
 
@@ -505,80 +1062,514 @@ void AVLTree<Key,Value>::removeFix(AVLNode<Key,Value>* n, int diff) {
   }
 }
 
-// precondition: n has a right child
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateRight(AVLNode<Key,Value>* n) {
-  
-  // std::cout << "rotating right " << n->getKey() << std::endl; 
-  
-  AVLNode<Key,Value>* g = n->getParent();   // grandparent
-  AVLNode<Key,Value>* a = n->getLeft();    // replacing n's node
-  AVLNode<Key,Value>* m = a->getRight();     // moving node
-
-  a->setParent(g); 
-  // If there is no parent, root must be updated
-  if(!g) 
-    BinarySearchTree<Key,Value>::root_ = a; 
-  else if(g->getLeft() == n)
-    g->setLeft(a); 
-  else if(g->getRight() == n)
-    g->setRight(a); 
-
-  n->setParent(a); 
-  a->setRight(n); 
-
-  n->setLeft(m); 
-  if(m) m->setParent(n); 
+// precondition: n has a left child
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::rotateRight(AVLNode<Key,Value>* n) {
+  BinarySearchTree<Key, Value, Compare>::rotateRight(n); 
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateLeft(AVLNode<Key,Value>* n) {
-  
-  // std::cout << "rotating left " << n->getKey() << std::endl; 
+// precondition: n has a right child
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::rotateLeft(AVLNode<Key,Value>* n) {
+  BinarySearchTree<Key, Value, Compare>::rotateLeft(n); 
+}
 
-  AVLNode<Key,Value>* g = n->getParent();   // grandparent
-  AVLNode<Key,Value>* a = n->getRight();    // replacing n's node
-  AVLNode<Key,Value>* m = a->getLeft();     // moving node
 
-  a->setParent(g); 
-  // if node has no parent, root must be updated
-  if(!g)
-    BinarySearchTree<Key,Value>::root_ = a; 
-  else if(g->getLeft() == n)
-    g->setLeft(a); 
-  else if(g->getRight() == n)
-    g->setRight(a); 
 
-  n->setParent(a); 
-  a->setLeft(n); 
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+{
+    BinarySearchTree<Key, Value, Compare>::nodeSwap(n1, n2);
+    int32_t tempB = n1->getBalance();
+    n1->setBalance(n2->getBalance());
+    n2->setBalance(tempB);
+    // pending marks belong to positions, so they swap along with the balances
+    bool tempP = n1->isPending();
+    n1->setPending(n2->isPending());
+    n2->setPending(tempP);
+}
 
-  n->setRight(m); 
-  if(m) m->setParent(n); 
+// allocates the node for a new key; derived trees return their own node type
+template<class Key, class Value, class Compare>
+AVLNode<Key,Value>* AVLTree<Key, Value, Compare>::createNode(const Key& key, const Value& value, AVLNode<Key,Value>* parent)
+{
+    return new AVLNode<Key, Value>(key, value, parent);
 }
 
+// Called when n's children were relinked outside a rotation (by join), so
+// derived trees can rebuild n's own per-node data from its children.
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::childrenChanged(AVLNode<Key,Value>*)
+{
 
+}
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+// Called before rebalancing whenever the items in the subtree of n (and so of
+// all its ancestors) changed: a node was linked in or spliced out below n, or
+// n's value was overwritten.  Lets derived trees refresh per-node data along
+// the path; rotations are virtual and handle their own nodes.
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::pathChanged(AVLNode<Key,Value>* n)
 {
-    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
-    int8_t tempB = n1->getBalance();
-    n1->setBalance(n2->getBalance());
-    n2->setBalance(tempB);
+
 }
 
-template<class Key, class Value>
-int AVLTree<Key, Value>::height(AVLNode<Key,Value>* n) {
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::height(AVLNode<Key,Value>* n) {
   if(!n) return 0; 
   return 1 + std::max(height(n->getLeft()), height(n->getRight())); 
 }
 
-template<class Key, class Value>
-bool AVLTree<Key, Value>::verifyBalances(AVLNode<Key,Value>* n) {
+template<class Key, class Value, class Compare>
+const AVLNode<Key,Value>* AVLTree<Key, Value, Compare>::rootNode() const
+{
+    return static_cast<const AVLNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_);
+}
+
+/**
+* The tree height, O(1).  Every update that changes it (a retrace or fix-up
+* reaching the root, a rotation at the root, a rebuild, a range erase, a
+* clear) adjusts the cached value, so this only reads it.  An empty tree has
+* height 0.
+*/
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::height() const
+{
+    return height_;
+}
+
+/**
+* Eager updates keep every balance within [-1, 1].  In relaxed mode only the
+* pending nodes can be out of balance, and they hang together from the root,
+* so only they are checked: O(1) unless rebalancing is pending.
+*/
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::isBalanced() const
+{
+    return pendingBalanced(static_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_));
+}
+
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::pendingBalanced(AVLNode<Key,Value>* n)
+{
+    if(!n || !n->isPending()) return true;
+    if(n->getBalance() < -1 || n->getBalance() > 1) return false;
+    return pendingBalanced(n->getLeft()) && pendingBalanced(n->getRight());
+}
+
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::verifyStatistics() const
+{
+    AVLNode<Key,Value>* root = static_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_);
+    size_t count = 0;
+    bool ok = true;
+    int h = verifySubtree(root, count, ok);
+    return ok && count == this->size() && h == height() &&
+           isBalanced() == (BinarySearchTree<Key, Value, Compare>::isBalancedHelper(root) >= 0);
+}
+
+// one post-order pass: returns the true height, counts the nodes and clears
+// ok on any wrong balance or a node out of balance without a pending mark
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::verifySubtree(AVLNode<Key,Value>* n, size_t& count, bool& ok)
+{
+    if(!n) return 0;
+    int left = verifySubtree(n->getLeft(), count, ok);
+    int right = verifySubtree(n->getRight(), count, ok);
+    count++;
+    if(n->getBalance() != right - left) ok = false;
+    if((right - left < -1 || right - left > 1) && !n->isPending()) ok = false;
+    return 1 + std::max(left, right);
+}
+
+/**
+* The top splitDepth levels are checked by tasks that hand their left subtree
+* to the pool and do the right one themselves; below that each subtree is
+* walked iteratively, so a degenerate (e.g. corrupted) tree cannot overflow
+* the stack.  A child whose parent pointer is wrong is reported and not
+* entered, so even a cyclic link structure is walked as a tree.  Once any
+* task finds a violation the others stop early.
+*/
+template<class Key, class Value, class Compare>
+const char* AVLTree<Key, Value, Compare>::verifyParallel(WorkStealingPool& pool, iterator* where) const
+{
+    AVLNode<Key,Value>* root = static_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_);
+    VerifyResult result = { 0, 0, NULL, NULL, false };
+    std::atomic<bool> failed(false);
+
+    // enough tasks for every thread to steal a few
+    int splitDepth = pool.forkDepth();
+
+    if(root && root->getParent()) {
+      result.what = "root has a parent";
+      result.where = root;
+    }
+    else if(root) {
+      verifyPart(root, NULL, NULL, splitDepth, pool, failed, result);
+    }
+    if(!result.what && result.count != this->size()) result.what = "size differs from the item count";
+    else if(!result.what && result.height != height()) result.what = "height differs from the cached height";
+
+    if(where) *where = this->makeIterator(result.where);
+    return result.what;
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::verifyPart(AVLNode<Key,Value>* n, AVLNode<Key,Value>* lo, AVLNode<Key,Value>* hi,
+                                              int splitDepth, WorkStealingPool& pool,
+                                              std::atomic<bool>& failed, VerifyResult& out) const
+{
+    AVLNode<Key,Value>* left = n->getLeft();
+    AVLNode<Key,Value>* right = n->getRight();
+    if(splitDepth == 0 || !left || !right) {
+      verifySequential(n, lo, hi, failed, out);
+      return;
+    }
+
+    // CASE 1: n itself or a link to a child is broken
+    const char* what = verifyNode(n, lo, hi);
+    if(!what && left->getParent() != n) { what = "wrong parent pointer"; n = left; }
+    if(!what && right->getParent() != n) { what = "wrong parent pointer"; n = right; }
+    if(what) {
+      out.what = what;
+      out.where = n;
+      failed = true;
+      return;
+    }
+
+    // CASE 2: check both subtrees in parallel, then n's balance
+    VerifyResult l = { 0, 0, NULL, NULL, false };
+    VerifyResult r = { 0, 0, NULL, NULL, false };
+    WorkStealingPool::TaskGroup group;
+    pool.spawn(group, [&]() { verifyPart(left, lo, n, splitDepth - 1, pool, failed, l); });
+    verifyPart(right, n, hi, splitDepth - 1, pool, failed, r);
+    pool.wait(group);
+
+    // prefer the leftmost violation; n's heights are only known if the
+    // right side finished cleanly too
+    if(l.what) out = l;
+    else if(!r.what && !l.stopped && !r.stopped && (what = verifyShape(n, l.height, r.height))) {
+      out.what = what;
+      out.where = n;
+      failed = true;
+    }
+    else if(r.what) out = r;
+    else if(l.stopped || r.stopped) out.stopped = true;
+    else {
+      out.height = 1 + std::max(l.height, r.height);
+      out.count = l.count + 1 + r.count;
+    }
+}
+
+// iterative post-order walk of one subtree
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::verifySequential(AVLNode<Key,Value>* n, AVLNode<Key,Value>* lo, AVLNode<Key,Value>* hi,
+                                                    std::atomic<bool>& failed, VerifyResult& out) const
+{
+    std::vector<VerifyFrame> stack;
+    VerifyFrame first = { n, lo, hi, 0, 0 };
+    stack.push_back(first);
+    int last = 0;
+    size_t count = 0;
+    const char* what = NULL;
+
+    while(!stack.empty() && !what) {
+      if(failed.load(std::memory_order_relaxed)) {
+        out.stopped = true;
+        return;
+      }
+      VerifyFrame& f = stack.back();
+      n = f.n;
+
+      // CASE 1: first visit, check the node and enter its left child
+      if(f.state == 0) {
+        if((what = verifyNode(n, f.lo, f.hi))) break;
+        count++;
+        f.state = 1;
+        AVLNode<Key,Value>* child = n->getLeft();
+        if(child) {
+          if(child->getParent() != n) { what = "wrong parent pointer"; n = child; break; }
+          VerifyFrame next = { child, f.lo, n, 0, 0 };
+          stack.push_back(next);
+          continue;
+        }
+        last = 0;
+      }
+
+      // CASE 2: left subtree done (its height is in last), enter the right
+      if(f.state == 1) {
+        f.leftHeight = last;
+        f.state = 2;
+        AVLNode<Key,Value>* child = n->getRight();
+        if(child) {
+          if(child->getParent() != n) { what = "wrong parent pointer"; n = child; break; }
+          VerifyFrame next = { child, n, f.hi, 0, 0 };
+          stack.push_back(next);
+          continue;
+        }
+        last = 0;
+      }
+
+      // CASE 3: both subtrees done
+      if((what = verifyShape(n, f.leftHeight, last))) break;
+      last = 1 + std::max(f.leftHeight, last);
+      stack.pop_back();
+    }
+
+    if(what) {
+      out.what = what;
+      out.where = n;
+      failed = true;
+      return;
+    }
+    out.height = last;
+    out.count = count;
+}
+
+// checks that n lies strictly between lo and hi (either may be NULL) and
+// that its pending mark is backed by its parent's
+template<class Key, class Value, class Compare>
+const char* AVLTree<Key, Value, Compare>::verifyNode(AVLNode<Key,Value>* n, AVLNode<Key,Value>* lo,
+                                                     AVLNode<Key,Value>* hi) const
+{
+    int cmin = uniqueKeys() ? 1 : 0;
+    if(lo && this->compareKeys(n->getKey(), lo->getKey()) < cmin) return "key out of order";
+    if(hi && this->compareKeys(hi->getKey(), n->getKey()) < cmin) return "key out of order";
+    if(n->isPending() && n->getParent() && !n->getParent()->isPending()) return "pending node under a settled parent";
+    return NULL;
+}
+
+// checks n's balance against the true heights of its subtrees
+template<class Key, class Value, class Compare>
+const char* AVLTree<Key, Value, Compare>::verifyShape(AVLNode<Key,Value>* n, int leftHeight, int rightHeight)
+{
+    int balance = rightHeight - leftHeight;
+    if(n->getBalance() != balance) return "wrong balance";
+    if((balance < -1 || balance > 1) && !n->isPending()) return "out of balance";
+    return NULL;
+}
+
+// keys are unique, so the order checks are strict
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::uniqueKeys() const
+{
+    return true;
+}
+
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::verifyBalances(AVLNode<Key,Value>* n) {
   if(!n) return true; 
   if((height(n->getRight()) - height(n->getLeft())) != n->getBalance()) return false; 
   return verifyBalances(n->getLeft()) && verifyBalances(n->getRight()); 
 }
 
+/**
+* Turns relaxed-balance mode on or off.  While on, each update runs at most
+* stepsPerUpdate rebalancing steps (0 defers everything to rebalanceSteps /
+* finishRebalance).  Turning it off drains the pending work so the eager
+* insert/remove paths see a valid AVL tree again.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::setRelaxed(bool relaxed, unsigned stepsPerUpdate)
+{
+    relaxed_ = relaxed;
+    stepsPerUpdate_ = stepsPerUpdate;
+    if(!relaxed) finishRebalance();
+}
+
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::isRelaxed() const
+{
+    return relaxed_;
+}
+
+/**
+* Runs up to maxSteps rebalancing steps and returns how many were needed.
+* A step clears one mark or does one (single or double) rotation; the
+* search for the next pending node resumes where the last step left off.
+*/
+template<class Key, class Value, class Compare>
+size_t AVLTree<Key, Value, Compare>::rebalanceSteps(size_t maxSteps)
+{
+    AVLNode<Key,Value>* n = static_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_);
+    if(!n || !n->isPending()) return 0;
+
+    size_t steps = 0;
+    while(n && steps < maxSteps) {
+      n = rebalanceStep(n);
+      steps++;
+    }
+    return steps;
+}
+
+/**
+* Runs rebalancing steps until the tree is a valid AVL tree again.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::finishRebalance()
+{
+    rebalanceSteps((size_t)-1);
+}
+
+// the pending marks are closed under ancestors, so the root carries one
+// whenever any node does
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::rebalancePending() const
+{
+    AVLNode<Key,Value>* root = static_cast<AVLNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_);
+    return root && root->isPending();
+}
+
+// Called after every relaxed update: a fixed budget of steps, never a drain.
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::relaxedUpdateDone()
+{
+    rebalanceSteps(stepsPerUpdate_);
+}
+
+// marks n and its ancestors up to the first one already marked
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::markPending(AVLNode<Key,Value>* n)
+{
+    while(n && !n->isPending()) {
+      n->setPending(true);
+      n = n->getParent();
+    }
+}
+
+/**
+* The child subtree of n on the given side changed height by delta.  Updates
+* the balances from n upwards for as long as subtree heights keep changing and
+* marks every node that ends up out of balance.  n may be NULL when the
+* changed subtree is the whole tree.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::retrace(AVLNode<Key,Value>* n, bool left, int delta)
+{
+    while(n && delta) {
+      int b = n->getBalance();
+      // heights are relative to n's left subtree
+      int nb, ndelta;
+      if(left) {
+        nb = b - delta;
+        ndelta = std::max(delta, b) - std::max(0, b);
+      }
+      else {
+        nb = b + delta;
+        ndelta = std::max(0, nb) - std::max(0, b);
+      }
+      n->setBalance(nb);
+      if(nb < -1 || nb > 1) markPending(n);
+
+      AVLNode<Key,Value>* p = n->getParent();
+      left = p && p->getLeft() == n;
+      n = p;
+      delta = ndelta;
+    }
+    // the change reached the root
+    if(!n) height_ += delta;
+}
+
+/**
+* Rotates left at n for nodes of any balance and sets the exact balances of n
+* and its old right child.  Returns the change in the subtree's height.
+*/
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::relaxedRotateLeft(AVLNode<Key,Value>* n)
+{
+    AVLNode<Key,Value>* c = n->getRight();
+    int bn = n->getBalance(), bc = c->getBalance();
+
+    // heights relative to n's left subtree
+    int hc = bn;
+    int hcl = (bc >= 0) ? hc - 1 - bc : hc - 1;
+    int hcr = (bc >= 0) ? hc - 1 : hc - 1 + bc;
+    int hn = 1 + std::max(0, hcl);
+
+    rotateLeft(n);
+    n->setBalance(hcl);
+    c->setBalance(hcr - hn);
+    return std::max(hn, hcr) - std::max(0, hc);
+}
+
+// mirror image of relaxedRotateLeft
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::relaxedRotateRight(AVLNode<Key,Value>* n)
+{
+    AVLNode<Key,Value>* c = n->getLeft();
+    int bn = n->getBalance(), bc = c->getBalance();
+
+    // heights relative to n's right subtree
+    int hc = -bn;
+    int hcl = (bc <= 0) ? hc - 1 : hc - 1 - bc;
+    int hcr = (bc <= 0) ? hc - 1 + bc : hc - 1;
+    int hn = 1 + std::max(hcr, 0);
+
+    rotateRight(n);
+    n->setBalance(-hcr);
+    c->setBalance(hn - hcl);
+    return std::max(hcl, hn) - std::max(hc, 0);
+}
+
+/**
+* One rebalancing step below the pending node n.  Finds the lowest pending
+* node there; everything below it is a valid AVL subtree.  If that node is in
+* balance its mark is cleared, otherwise a single or double rotation moves it
+* down with a smaller imbalance.  Returns the pending node to continue from,
+* or NULL once nothing is pending.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key,Value>* AVLTree<Key, Value, Compare>::rebalanceStep(AVLNode<Key,Value>* n)
+{
+    while(true) {
+      if(n->getLeft() && n->getLeft()->isPending()) n = n->getLeft();
+      else if(n->getRight() && n->getRight()->isPending()) n = n->getRight();
+      else break;
+    }
+
+    int b = n->getBalance();
+    // CASE 1: node is in balance, just clear the mark
+    if(b >= -1 && b <= 1) {
+      n->setPending(false);
+      return n->getParent();
+    }
+
+    AVLNode<Key,Value>* p = n->getParent();
+    bool left = p && p->getLeft() == n;
+    AVLNode<Key,Value>* top;
+    int delta = 0;
+
+    // CASE 2: right heavy
+    if(b > 1) {
+      // CASE 2A: ZIG-ZAG, first rotate the right child (n's right side changes height)
+      if(n->getRight()->getBalance() < 0) {
+        int d = relaxedRotateRight(n->getRight());
+        n->setBalance(b + d);
+        delta = std::max(0, b + d) - std::max(0, b);
+      }
+      top = n->getRight();
+      delta += relaxedRotateLeft(n);
+    }
+    // CASE 3: left heavy
+    else {
+      // CASE 3A: ZIG-ZAG, first rotate the left child (n's left side changes height)
+      if(n->getLeft()->getBalance() > 0) {
+        int d = relaxedRotateLeft(n->getLeft());
+        n->setBalance(b - d);
+        delta = std::max(0, d - b) - std::max(0, -b);
+      }
+      top = n->getLeft();
+      delta += relaxedRotateRight(n);
+    }
+
+    // n may still be out of balance (it was by more than 2); top takes over
+    // n's place in the marked set
+    n->setPending(n->getBalance() < -1 || n->getBalance() > 1);
+    top->setPending(n->isPending() || top->getBalance() < -1 || top->getBalance() > 1);
+
+    if(delta) retrace(p, left, delta);
+    return top->isPending() ? top : p;
+}
+
 
 #endif
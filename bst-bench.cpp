@@ -0,0 +1,480 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <new>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <malloc.h>
+#include "bst.h"
+#include "avlbst.h"
+#include "tdavlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "scapegoatbst.h"
+
+using namespace std;
+
+/*
+  Benchmark harness for the search tree engines.
+
+  Every engine runs the same generated op streams and reports one CSV row
+  per (engine, workload, keys) with throughput, sampled p50/p99 latency
+  and live heap bytes per entry.  std::map is the baseline.
+
+  usage: bst-bench [--min-keys N] [--max-keys N] [--ops N] [--seed S]
+                   [--engines a,b,...] [--workloads x,y,...] [--no-header]
+*/
+
+// ---------------------------------------------------------------------------
+// Heap accounting.  Live bytes are tracked through the usable size of each
+// malloc block, so allocator rounding shows up in bytes per entry.
+// ---------------------------------------------------------------------------
+
+// Updated from every thread that allocates, so relaxed atomic adds keep the
+// count exact without ordering anything else.
+static std::atomic<size_t> g_liveBytes(0);
+
+// Kept out of line so the compiler does not pair the malloc/free calls
+// with the new/delete expressions at each call site.
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    void* ptr = malloc(size ? size : 1);
+    if(!ptr) throw std::bad_alloc();
+    g_liveBytes.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed);
+    return ptr;
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept
+{
+    if(!ptr) return;
+    g_liveBytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+    free(ptr);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+
+// ---------------------------------------------------------------------------
+// Key generation
+// ---------------------------------------------------------------------------
+
+// Bijective scramble of a rank into a key so that "random" keys are distinct
+// without keeping a permutation of the whole key space around.  Every step
+// (multiply by an odd constant, xorshift) is invertible modulo 2^31, so
+// distinct ranks below 2^31 give distinct non-negative keys.
+static int scrambleKey(uint32_t rank)
+{
+    const uint32_t mask = 0x7fffffff;
+    uint32_t x = (rank * 2654435761u) & mask;
+    x ^= x >> 15;
+    x = (x * 2246822519u) & mask;
+    x ^= x >> 13;
+    return static_cast<int>(x);
+}
+
+/**
+ * Zipf distributed ranks in [0, n) with skew theta, following the
+ * generator from Gray et al. ("Quickly Generating Billion-Record
+ * Synthetic Databases"), as used by YCSB.
+ */
+class ZipfGenerator
+{
+public:
+    ZipfGenerator(uint64_t n, double theta) : n_(n), theta_(theta)
+    {
+        zetan_ = zeta(n, theta);
+        double zeta2 = zeta(2, theta);
+        alpha_ = 1.0 / (1.0 - theta);
+        eta_ = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan_);
+    }
+
+    template<typename Rng>
+    uint64_t next(Rng& rng)
+    {
+        double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetan_;
+        if(uz < 1.0) return 0;
+        if(uz < 1.0 + pow(0.5, theta_)) return 1;
+        uint64_t r = static_cast<uint64_t>(n_ * pow(eta_ * u - eta_ + 1.0, alpha_));
+        return r >= n_ ? n_ - 1 : r;
+    }
+
+private:
+    static double zeta(uint64_t n, double theta)
+    {
+        double sum = 0;
+        for(uint64_t i = 1; i <= n; i++) sum += 1.0 / pow((double)i, theta);
+        return sum;
+    }
+
+    uint64_t n_;
+    double theta_, zetan_, alpha_, eta_;
+};
+
+// ---------------------------------------------------------------------------
+// Workloads
+// ---------------------------------------------------------------------------
+
+enum OpType { OP_FIND, OP_INSERT, OP_REMOVE };
+
+struct Op
+{
+    uint8_t type;
+    int key;
+};
+
+struct Workload
+{
+    string name;
+    vector<int> preload;   // inserted before timing starts
+    vector<Op> ops;        // the measured op stream
+    bool sortedInput;      // degenerates an unbalanced tree
+};
+
+static void addPreload(Workload& w, uint64_t n)
+{
+    w.preload.reserve(n);
+    for(uint64_t i = 0; i < n; i++) w.preload.push_back(scrambleKey((uint32_t)i));
+}
+
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+    while(b) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// A step through [0, n) that visits every rank once before repeating.
+static uint64_t coprimeStride(uint64_t n)
+{
+    uint64_t stride = 1000003 % n;
+    while(stride == 0 || gcd(stride, n) != 1) stride++;
+    return stride;
+}
+
+// Builds a mixed op stream over a preloaded key space of n keys.
+// Inserts always use fresh keys past the preloaded ranks; removes walk the
+// preloaded ranks with a stride coprime to n so each key is hit at most once.
+static void addMix(Workload& w, uint64_t n, uint64_t m, int findPct, int insertPct,
+                   mt19937_64& rng)
+{
+    uint64_t stride = coprimeStride(n);
+    uint64_t nextNew = n, nextRemove = 0;
+    uniform_int_distribution<uint64_t> rank(0, n - 1);
+    uniform_int_distribution<int> pct(0, 99);
+    w.ops.reserve(m);
+    for(uint64_t i = 0; i < m; i++) {
+        int p = pct(rng);
+        Op op;
+        if(p < findPct) {
+            op.type = OP_FIND;
+            op.key = scrambleKey((uint32_t)rank(rng));
+        }
+        else if(p < findPct + insertPct) {
+            op.type = OP_INSERT;
+            op.key = scrambleKey((uint32_t)nextNew++);
+        }
+        else {
+            op.type = OP_REMOVE;
+            op.key = scrambleKey((uint32_t)((nextRemove++ * stride) % n));
+        }
+        w.ops.push_back(op);
+    }
+}
+
+static bool makeWorkload(const string& name, uint64_t n, uint64_t opsCap, uint64_t seed,
+                         Workload& w)
+{
+    mt19937_64 rng(seed ^ (n * 0x9e3779b97f4a7c15ull));
+    uint64_t m = std::min(n, opsCap);
+    w.name = name;
+    w.preload.clear();
+    w.ops.clear();
+    w.sortedInput = false;
+
+    if(name == "sequential") {
+        w.sortedInput = true;
+        w.ops.reserve(n);
+        for(uint64_t i = 0; i < n; i++) {
+            Op op = { OP_INSERT, (int)i };
+            w.ops.push_back(op);
+        }
+    }
+    else if(name == "random") {
+        w.ops.reserve(n);
+        for(uint64_t i = 0; i < n; i++) {
+            Op op = { OP_INSERT, scrambleKey((uint32_t)i) };
+            w.ops.push_back(op);
+        }
+    }
+    else if(name == "zipf") {
+        addPreload(w, n);
+        ZipfGenerator zipf(n, 0.99);
+        w.ops.reserve(m);
+        for(uint64_t i = 0; i < m; i++) {
+            Op op = { OP_FIND, scrambleKey((uint32_t)zipf.next(rng)) };
+            w.ops.push_back(op);
+        }
+    }
+    else if(name == "read-heavy") {
+        addPreload(w, n);
+        addMix(w, n, m, 95, 5, rng);
+    }
+    else if(name == "write-heavy") {
+        addPreload(w, n);
+        addMix(w, n, m, 20, 50, rng);
+    }
+    else if(name == "delete-heavy") {
+        addPreload(w, n);
+        addMix(w, n, m, 10, 20, rng);
+    }
+    else if(name == "churn") {
+        // strict remove/insert alternation at a constant tree size, which
+        // keeps every update on the rebalancing path
+        addPreload(w, n);
+        uint64_t stride = coprimeStride(n);
+        w.ops.reserve(m);
+        for(uint64_t i = 0; i < m; i++) {
+            Op op = { (uint8_t)(i % 2 ? OP_INSERT : OP_REMOVE), 0 };
+            op.key = i % 2 ? scrambleKey((uint32_t)(n + i / 2))
+                           : scrambleKey((uint32_t)(((i / 2) * stride) % n));
+            w.ops.push_back(op);
+        }
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Engines
+// ---------------------------------------------------------------------------
+
+/**
+ * Adapter for any tree following the BinarySearchTree interface.
+ */
+template<typename Tree>
+struct TreeEngine
+{
+    Tree tree;
+
+    void insert(int k, int v) { tree.insert(std::make_pair(k, v)); }
+    // non-const so that self-adjusting trees restructure on lookups
+    bool find(int k) { return tree.find(k) != tree.end(); }
+    void remove(int k) { tree.remove(k); }
+    size_t size() const
+    {
+        size_t count = 0;
+        for(auto it = tree.begin(); it != tree.end(); ++it) count++;
+        return count;
+    }
+};
+
+// Semi-splaying that only restructures on every fourth read.
+struct LazySplayTree : public SplayTree<int, int>
+{
+    LazySplayTree() : SplayTree<int, int>(SEMI_SPLAY, 4) { }
+};
+
+struct RelaxedAVLTree : public AVLTree<int, int>
+{
+    RelaxedAVLTree() { setRelaxed(true, 4); }
+};
+
+struct MapEngine
+{
+    std::map<int, int> tree;
+
+    void insert(int k, int v) { tree[k] = v; }
+    bool find(int k) const { return tree.find(k) != tree.end(); }
+    void remove(int k) { tree.erase(k); }
+    size_t size() const { return tree.size(); }
+};
+
+struct Result
+{
+    uint64_t ops;
+    double seconds;
+    double p50;
+    double p99;
+    double bytesPerEntry;
+};
+
+typedef chrono::steady_clock Clock;
+
+// Every kLatencySample-th op is timed individually for the latency
+// percentiles; the loop as a whole is timed for throughput.
+static const uint64_t kLatencySample = 16;
+
+template<typename Engine>
+static inline void applyOp(Engine& e, const Op& op, uint64_t& hits)
+{
+    if(op.type == OP_FIND) hits += e.find(op.key);
+    else if(op.type == OP_INSERT) e.insert(op.key, op.key);
+    else e.remove(op.key);
+}
+
+template<typename Engine>
+static Result runEngine(const Workload& w)
+{
+    Result r;
+    vector<double> latencies;
+    latencies.reserve(w.ops.size() / kLatencySample + 1);
+
+    size_t baseline = g_liveBytes.load(std::memory_order_relaxed);
+    Engine* e = new Engine();
+    for(size_t i = 0; i < w.preload.size(); i++) e->insert(w.preload[i], w.preload[i]);
+
+    uint64_t hits = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < w.ops.size(); i++) {
+        if(i % kLatencySample == 0) {
+            Clock::time_point t0 = Clock::now();
+            applyOp(*e, w.ops[i], hits);
+            Clock::time_point t1 = Clock::now();
+            latencies.push_back(chrono::duration<double, nano>(t1 - t0).count());
+        }
+        else {
+            applyOp(*e, w.ops[i], hits);
+        }
+    }
+    Clock::time_point stop = Clock::now();
+
+    size_t live = g_liveBytes.load(std::memory_order_relaxed) - baseline;
+    size_t entries = e->size();
+    delete e;
+
+    r.ops = w.ops.size();
+    r.seconds = chrono::duration<double>(stop - start).count();
+    r.bytesPerEntry = entries ? (double)live / entries : 0.0;
+    r.p50 = r.p99 = 0;
+    if(!latencies.empty()) {
+        size_t i50 = latencies.size() / 2;
+        size_t i99 = std::min(latencies.size() - 1, (size_t)(latencies.size() * 0.99));
+        nth_element(latencies.begin(), latencies.begin() + i50, latencies.end());
+        r.p50 = latencies[i50];
+        nth_element(latencies.begin(), latencies.begin() + i99, latencies.end());
+        r.p99 = latencies[i99];
+    }
+    // keep the find results observable so the lookups are not optimized away
+    if(hits == (uint64_t)-1) cerr << hits;
+    return r;
+}
+
+typedef Result (*EngineFn)(const Workload&);
+
+struct EngineInfo
+{
+    const char* name;
+    EngineFn run;
+    // largest key count this engine is run at on sorted input (0 = no limit);
+    // an unbalanced tree turns sorted input into an O(n^2) list build
+    uint64_t sortedLimit;
+};
+
+static const EngineInfo kEngines[] = {
+    { "std::map", &runEngine<MapEngine>, 0 },
+    { "BinarySearchTree", &runEngine<TreeEngine<BinarySearchTree<int, int> > >, 20000 },
+    { "AVLTree", &runEngine<TreeEngine<AVLTree<int, int> > >, 0 },
+    { "TopDownAVLTree", &runEngine<TreeEngine<TopDownAVLTree<int, int> > >, 0 },
+    { "RedBlackTree", &runEngine<TreeEngine<RedBlackTree<int, int> > >, 0 },
+    { "AVLTree/relaxed-4", &runEngine<TreeEngine<RelaxedAVLTree> >, 0 },
+    { "SplayTree", &runEngine<TreeEngine<SplayTree<int, int> > >, 0 },
+    { "SplayTree/semi-k4", &runEngine<TreeEngine<LazySplayTree> >, 0 },
+    { "ScapegoatTree", &runEngine<TreeEngine<ScapegoatTree<int, int> > >, 0 },
+};
+
+static const char* kWorkloads[] = {
+    "sequential", "random", "zipf", "read-heavy", "write-heavy", "delete-heavy", "churn"
+};
+
+// ---------------------------------------------------------------------------
+// Driver
+// ---------------------------------------------------------------------------
+
+static vector<string> splitList(const string& s)
+{
+    vector<string> out;
+    stringstream ss(s);
+    string item;
+    while(getline(ss, item, ',')) if(!item.empty()) out.push_back(item);
+    return out;
+}
+
+static bool selected(const vector<string>& filter, const string& name)
+{
+    return filter.empty() || find(filter.begin(), filter.end(), name) != filter.end();
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t minKeys = 1000, maxKeys = 1000000, opsCap = 1000000, seed = 104;
+    vector<string> engines, workloads;
+    bool header = true;
+
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--min-keys" && hasValue) minKeys = strtoull(argv[++i], NULL, 10);
+        else if(arg == "--max-keys" && hasValue) maxKeys = strtoull(argv[++i], NULL, 10);
+        else if(arg == "--ops" && hasValue) opsCap = strtoull(argv[++i], NULL, 10);
+        else if(arg == "--seed" && hasValue) seed = strtoull(argv[++i], NULL, 10);
+        else if(arg == "--engines" && hasValue) engines = splitList(argv[++i]);
+        else if(arg == "--workloads" && hasValue) workloads = splitList(argv[++i]);
+        else if(arg == "--no-header") header = false;
+        else {
+            cerr << "usage: " << argv[0] << " [--min-keys N] [--max-keys N] [--ops N] [--seed S]"
+                 << " [--engines a,b] [--workloads x,y] [--no-header]" << endl;
+            return 1;
+        }
+    }
+    if(minKeys < 2) minKeys = 2;
+
+    char stamp[32];
+    time_t now = time(NULL);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    if(header) {
+        cout << "run,engine,workload,keys,ops,seconds,ops_per_sec,p50_ns,p99_ns,bytes_per_entry"
+             << endl;
+    }
+
+    Workload w;
+    for(uint64_t n = minKeys; n <= maxKeys; n *= 10) {
+        for(size_t wi = 0; wi < sizeof(kWorkloads) / sizeof(kWorkloads[0]); wi++) {
+            if(!selected(workloads, kWorkloads[wi])) continue;
+            makeWorkload(kWorkloads[wi], n, opsCap, seed, w);
+            for(size_t ei = 0; ei < sizeof(kEngines) / sizeof(kEngines[0]); ei++) {
+                const EngineInfo& engine = kEngines[ei];
+                if(!selected(engines, engine.name)) continue;
+                if(w.sortedInput && engine.sortedLimit && n > engine.sortedLimit) {
+                    cerr << "skipping " << engine.name << " " << w.name << " at " << n
+                         << " keys (sorted input)" << endl;
+                    continue;
+                }
+                Result r = engine.run(w);
+                cout << stamp << ',' << engine.name << ',' << w.name << ',' << n << ','
+                     << r.ops << ',' << fixed << setprecision(6) << r.seconds << ','
+                     << setprecision(0) << (r.seconds > 0 ? r.ops / r.seconds : 0.0) << ','
+                     << setprecision(1) << r.p50 << ',' << r.p99 << ','
+                     << r.bytesPerEntry << endl;
+                cout.unsetf(ios::floatfield);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,617 @@
+#include <iostream>
+#include <map>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <iterator>
+#include <type_traits>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "scapegoatbst.h"
+#include "tree-check.h"
+
+using namespace std;
+
+/*
+  Assertion tests for the operations every engine inherits from
+  BinarySearchTree.  Each test runs on the plain tree and on every engine
+  derived from it, since each engine overrides the hooks underneath.
+*/
+
+// the structural invariants of each engine
+static bool valid(const BinarySearchTree<int,int>& tree)
+{
+    return isSearchTree(tree);
+}
+
+static bool valid(const AVLTree<int,int>& tree)
+{
+    return isSearchTree(tree) && tree.isBalanced() && tree.verifyStatistics();
+}
+
+static bool valid(const RedBlackTree<int,int>& tree)
+{
+    return isSearchTree(tree) && tree.isBalanced();
+}
+
+// fills tree and ref with the same random items
+template<typename Tree>
+void fill(Tree& tree, map<int,int>& ref, unsigned seed, int keys)
+{
+    churn(tree, ref, seed, keys * 3, keys, [](const Tree& t) { return valid(t); });
+}
+
+template<typename Tree>
+void testCopyMoveSwap()
+{
+    Tree tree;
+    map<int,int> ref;
+    fill(tree, ref, 1, 1000);
+
+    Tree copy(tree);
+    CHECK(valid(copy) && sameItems(copy, ref));
+    // the copy owns its nodes
+    copy.insert(make_pair(-1, -1));
+    copy.remove(ref.begin()->first);
+    CHECK(valid(tree) && sameItems(tree, ref));
+
+    Tree assigned;
+    assigned.insert(make_pair(5, 5));
+    assigned = tree;
+    CHECK(valid(assigned) && sameItems(assigned, ref));
+    Tree& self = assigned;
+    assigned = self;
+    CHECK(valid(assigned) && sameItems(assigned, ref));
+
+    Tree moved(std::move(assigned));
+    CHECK(valid(moved) && sameItems(moved, ref));
+    // a moved-from tree is empty and usable
+    CHECK(assigned.empty() && assigned.size() == 0 && valid(assigned));
+    assigned.insert(make_pair(1, 1));
+    CHECK(valid(assigned) && assigned.size() == 1);
+
+    map<int,int> otherRef;
+    Tree other;
+    fill(other, otherRef, 2, 300);
+    moved = std::move(other);
+    CHECK(valid(moved) && sameItems(moved, otherRef));
+    CHECK(other.empty() && valid(other));
+
+    tree.swap(moved);
+    CHECK(valid(tree) && sameItems(tree, otherRef));
+    CHECK(valid(moved) && sameItems(moved, ref));
+    // both keep working on the nodes they received
+    churn(tree, otherRef, 3, 1000, 300, [](const Tree& t) { return valid(t); });
+    churn(moved, ref, 4, 1000, 1000, [](const Tree& t) { return valid(t); });
+}
+
+template<typename Tree>
+void testNodeHandles()
+{
+    Tree source;
+    map<int,int> sourceRef;
+    fill(source, sourceRef, 5, 1000);
+    Tree target;
+    map<int,int> targetRef;
+    fill(target, targetRef, 6, 1000);
+
+    // a missing key or end() gives an empty handle, which inserts nothing
+    typename Tree::node_type none = source.extract(-1);
+    CHECK(none.empty() && !none);
+    CHECK(source.extract(source.end()).empty());
+    CHECK(target.insert(std::move(none)) == target.end());
+
+    // move every third item across, by key and by iterator
+    mt19937 rng(7);
+    int moved = 0;
+    while(!sourceRef.empty() && moved < 300) {
+      map<int,int>::iterator r = sourceRef.lower_bound(rng() % 1000);
+      if(r == sourceRef.end()) r = sourceRef.begin();
+      typename Tree::node_type handle = moved % 2 ? source.extract(r->first)
+                                                  : source.extract(source.lower_bound(r->first));
+      CHECK(handle && handle.key() == r->first && handle.mapped() == r->second);
+      handle.mapped() += 1;
+      typename Tree::iterator it = target.insert(std::move(handle));
+      CHECK(handle.empty());
+      // an existing key gets the new value, like insert(pair)
+      targetRef[r->first] = r->second + 1;
+      CHECK(it->first == r->first && it->second == r->second + 1);
+      sourceRef.erase(r);
+      moved++;
+    }
+    CHECK(valid(source) && sameItems(source, sourceRef));
+    CHECK(valid(target) && sameItems(target, targetRef));
+
+    // a handle that is never inserted frees its node (checked under ASan)
+    typename Tree::node_type dropped = target.extract(target.begin());
+    typename Tree::node_type kept(std::move(dropped));
+    CHECK(dropped.empty() && !kept.empty());
+    targetRef.erase(targetRef.begin());
+    CHECK(valid(target) && sameItems(target, targetRef));
+}
+
+// nodes only go into trees of the kind they came from
+static void testIncompatibleHandle()
+{
+    AVLTree<int,int> avl;
+    avl.insert(make_pair(1, 1));
+    RedBlackTree<int,int> rb;
+    BinarySearchTree<int,int>::node_type handle = avl.extract(1);
+    bool thrown = false;
+    try {
+      rb.insert(std::move(handle));
+    }
+    catch(const invalid_argument&) {
+      thrown = true;
+    }
+    CHECK(thrown && !handle.empty() && rb.empty());
+    avl.insert(std::move(handle));
+    CHECK(avl.size() == 1 && valid(avl));
+}
+
+template<typename Tree>
+void testErase()
+{
+    Tree tree;
+    map<int,int> ref;
+    fill(tree, ref, 8, 3000);
+    mt19937 rng(9);
+
+    // single items; the result is the next item
+    for(int i = 0; i < 300 && !ref.empty(); i++) {
+      map<int,int>::iterator r = ref.lower_bound(rng() % 3000);
+      if(r == ref.end()) continue;
+      typename Tree::iterator next = tree.erase(tree.lower_bound(r->first));
+      r = ref.erase(r);
+      CHECK(r == ref.end() ? next == tree.end() : next->first == r->first);
+    }
+    CHECK(valid(tree) && sameItems(tree, ref));
+
+    // ranges split the tree around both ends and join what is left
+    for(int i = 0; i < 100; i++) {
+      int lo = rng() % 3100 - 50;
+      int hi = lo + rng() % (i % 10 == 0 ? 3000 : 60);
+      typename Tree::iterator next = tree.erase(tree.lower_bound(lo), tree.lower_bound(hi));
+      map<int,int>::iterator r = ref.erase(ref.lower_bound(lo), ref.lower_bound(hi));
+      CHECK(r == ref.end() ? next == tree.end() : next->first == r->first);
+      if(i % 10 == 0) CHECK(valid(tree) && sameItems(tree, ref));
+      if(ref.size() < 500) fill(tree, ref, 10 + i, 3000);
+    }
+    CHECK(valid(tree) && sameItems(tree, ref));
+
+    // empty, prefix, suffix and whole-tree ranges
+    typename Tree::iterator first = tree.begin();
+    CHECK(tree.erase(first, first) == tree.begin());
+    CHECK(sameItems(tree, ref));
+    int third = next(ref.begin(), ref.size() / 3)->first;
+    tree.erase(tree.begin(), tree.lower_bound(third));
+    ref.erase(ref.begin(), ref.lower_bound(third));
+    CHECK(valid(tree) && sameItems(tree, ref));
+    int half = next(ref.begin(), ref.size() / 2)->first;
+    CHECK(tree.erase(tree.lower_bound(half), tree.end()) == tree.end());
+    ref.erase(ref.lower_bound(half), ref.end());
+    CHECK(valid(tree) && sameItems(tree, ref));
+    CHECK(tree.erase(tree.begin(), tree.end()) == tree.end());
+    CHECK(tree.empty() && valid(tree));
+    ref.clear();
+    fill(tree, ref, 20, 500);
+}
+
+// the cached extremes must follow every kind of update
+template<typename Tree>
+bool sameExtremes(Tree& tree, const map<int,int>& ref)
+{
+    const Tree& constTree = tree;
+    if(ref.empty()) return tree.min() == tree.end() && tree.max() == tree.end() &&
+                           constTree.min() == constTree.end() && constTree.max() == constTree.end();
+    return tree.min()->first == ref.begin()->first && tree.max()->first == ref.rbegin()->first &&
+           constTree.min()->first == ref.begin()->first && constTree.max()->first == ref.rbegin()->first;
+}
+
+template<typename Tree>
+void testPriorityQueue()
+{
+    Tree tree;
+    map<int,int> ref;
+    CHECK(sameExtremes(tree, ref));
+    // popping an empty tree does nothing
+    tree.pop_min();
+    tree.pop_max();
+    CHECK(tree.empty() && valid(tree));
+
+    mt19937 rng(11);
+    bool ok = true;
+    for(int i = 0; i < 20000; i++) {
+      int key = rng() % 5000;
+      switch(rng() % 5) {
+      case 0:
+        tree.pop_min();
+        if(!ref.empty()) ref.erase(ref.begin());
+        break;
+      case 1:
+        tree.pop_max();
+        if(!ref.empty()) ref.erase(prev(ref.end()));
+        break;
+      case 2:
+        tree.remove(key);
+        ref.erase(key);
+        break;
+      default:
+        tree.insert(make_pair(key, i));
+        ref[key] = i;
+      }
+      ok = ok && sameExtremes(tree, ref);
+      if(i % 1000 == 0) CHECK(valid(tree));
+    }
+    CHECK(ok);
+    CHECK(valid(tree) && sameItems(tree, ref));
+
+    // drain from both ends in turn
+    for(bool low = true; !ref.empty(); low = !low) {
+      if(low) {
+        CHECK(tree.min()->first == ref.begin()->first);
+        tree.pop_min();
+        ref.erase(ref.begin());
+      }
+      else {
+        CHECK(tree.max()->first == ref.rbegin()->first);
+        tree.pop_max();
+        ref.erase(prev(ref.end()));
+      }
+    }
+    CHECK(tree.empty() && sameExtremes(tree, ref) && valid(tree));
+}
+
+// the height of a perfectly balanced tree of n items
+static int minimalHeight(size_t n)
+{
+    int h = 0;
+    while(n) {
+      n >>= 1;
+      h++;
+    }
+    return h;
+}
+
+template<typename Tree>
+void testRebalance()
+{
+    Tree tree;
+    map<int,int> ref;
+    fill(tree, ref, 12, 5000);
+    // iterators stay valid across the rebuild
+    vector<typename Tree::iterator> held;
+    for(int key = 0; key < 5000; key += 97) {
+      if(ref.count(key)) held.push_back(tree.lower_bound(key));
+    }
+    tree.rebalance();
+    CHECK(valid(tree) && sameItems(tree, ref));
+    CHECK(subtreeHeight(tree.rootNode()) == minimalHeight(tree.size()));
+    bool ok = true;
+    for(size_t i = 0; i < held.size(); i++) ok = ok && ref.at(held[i]->first) == held[i]->second;
+    CHECK(ok);
+    // the engine carries on from the rebuilt shape
+    churn(tree, ref, 13, 5000, 5000, [](const Tree& t) { return valid(t); });
+
+    Tree empty;
+    empty.rebalance();
+    CHECK(empty.empty() && valid(empty));
+    empty.insert(make_pair(1, 1));
+    empty.rebalance();
+    CHECK(empty.size() == 1 && valid(empty));
+}
+
+// sorted inserts would make a plain tree a list; auto-rebalance bounds it.
+// Rebuilds wait for n / (factor * log2(n)) inserts, and a sorted run adds one
+// level per insert, so that is how far past a balanced height it may grow.
+static void testAutoRebalance()
+{
+    const double factor = 2;
+    BinarySearchTree<int,int> tree;
+    tree.setAutoRebalance(factor);
+    bool ok = true;
+    for(int i = 0; i < 20000; i++) {
+      tree.insert(make_pair(i, i));
+      double n = tree.size();
+      if(i % 100 == 0 && i >= 100) {
+        ok = ok && subtreeHeight(tree.rootNode()) <= minimalHeight(tree.size()) + n / (factor * log2(n)) + 2;
+      }
+    }
+    CHECK(ok);
+    CHECK(valid(tree) && tree.size() == 20000);
+    // 0 turns it off again
+    tree.setAutoRebalance(0);
+    tree.clear();
+    for(int i = 0; i < 100; i++) tree.insert(make_pair(i, i));
+    CHECK(subtreeHeight(tree.rootNode()) == 100);
+}
+
+// value_type is never const-qualified, only reference and pointer are
+typedef BinarySearchTree<int,int>::const_iterator ConstIterator;
+static_assert(is_same<iterator_traits<ConstIterator>::value_type, pair<const int,int> >::value,
+              "const_iterator::value_type");
+static_assert(is_same<iterator_traits<ConstIterator>::reference, const pair<const int,int>&>::value,
+              "const_iterator::reference");
+
+template<typename Tree>
+void testIteration()
+{
+    Tree tree;
+    map<int,int> ref;
+    fill(tree, ref, 14, 2000);
+    const Tree& constTree = tree;
+
+    // forward through the const overloads, and backwards both ways
+    typedef vector<pair<int,int> > Items;
+    Items expected(ref.begin(), ref.end());
+    CHECK(Items(constTree.begin(), constTree.end()) == expected);
+    CHECK(Items(tree.cbegin(), tree.cend()) == expected);
+    Items reversed(expected.rbegin(), expected.rend());
+    CHECK(Items(tree.rbegin(), tree.rend()) == reversed);
+    CHECK(Items(constTree.rbegin(), constTree.rend()) == reversed);
+    CHECK((size_t)distance(tree.rbegin(), tree.rend()) == ref.size());
+
+    // -- from end() is the largest item, and steps back through predecessors
+    typename Tree::iterator it = tree.end();
+    bool ok = true;
+    for(map<int,int>::reverse_iterator r = ref.rbegin(); r != ref.rend(); ++r) {
+      --it;
+      ok = ok && it->first == r->first;
+    }
+    CHECK(ok && it == tree.begin());
+    typename Tree::const_iterator cit = constTree.end();
+    --cit;
+    CHECK(cit->first == ref.rbegin()->first);
+
+    // a reverse scan from a position starts just before it
+    mt19937 rng(15);
+    ok = true;
+    for(int i = 0; i < 100; i++) {
+      int key = rng() % 2100;
+      typename Tree::const_reverse_iterator rit(constTree.lower_bound(key));
+      map<int,int>::const_reverse_iterator r(ref.lower_bound(key));
+      for(int k = 0; k < 5 && r != ref.rend(); k++, ++rit, ++r) ok = ok && rit->first == r->first;
+      ok = ok && (r != ref.rend() || rit == constTree.rend());
+    }
+    CHECK(ok);
+
+    // the const lookups agree with the map
+    ok = true;
+    for(int i = 0; i < 300; i++) {
+      int key = rng() % 2100;
+      ok = ok && (constTree.lower_bound(key) == constTree.end() ? ref.lower_bound(key) == ref.end()
+                                                                 : constTree.lower_bound(key)->first == ref.lower_bound(key)->first);
+      ok = ok && (constTree.upper_bound(key) == constTree.end() ? ref.upper_bound(key) == ref.end()
+                                                                 : constTree.upper_bound(key)->first == ref.upper_bound(key)->first);
+      pair<typename Tree::const_iterator, typename Tree::const_iterator> range = constTree.equal_range(key);
+      ok = ok && (size_t)distance(range.first, range.second) == ref.count(key);
+      ok = ok && constTree.count(key) == ref.count(key);
+    }
+    CHECK(ok);
+
+    // iterators convert to const_iterators and compare with them
+    typename Tree::const_iterator converted = tree.begin();
+    CHECK(converted == constTree.begin() && tree.begin() == converted);
+    CHECK(tree.end() == constTree.end());
+
+    // writes through iterators and reverse iterators reach the items
+    for(typename Tree::reverse_iterator rit = tree.rbegin(); rit != tree.rend(); ++rit) rit->second = -rit->first;
+    for(map<int,int>::iterator r = ref.begin(); r != ref.end(); ++r) r->second = -r->first;
+    CHECK(sameItems(tree, ref));
+
+    Tree empty;
+    const Tree& constEmpty = empty;
+    CHECK(empty.rbegin() == empty.rend() && constEmpty.rbegin() == constEmpty.rend());
+    CHECK(empty.cbegin() == empty.cend());
+}
+
+// the items of ref with lo <= key < hi
+static vector<pair<int,int> > bruteRange(const map<int,int>& ref, int lo, int hi)
+{
+    if(hi <= lo) return vector<pair<int,int> >();
+    return vector<pair<int,int> >(ref.lower_bound(lo), ref.lower_bound(hi));
+}
+
+template<typename Tree>
+void testScans()
+{
+    typedef vector<pair<int,int> > Items;
+    Tree tree;
+    map<int,int> ref;
+    fill(tree, ref, 16, 3000);
+    const Tree& constTree = tree;
+    mt19937 rng(17);
+    bool ok = true;
+    for(int i = 0; i < 300; i++) {
+      int lo = rng() % 3200 - 100;
+      int hi = lo + rng() % 400 - 20;
+      Items expected = bruteRange(ref, lo, hi);
+
+      // the callback sees the half-open range in order
+      Items seen;
+      size_t n = constTree.scan(lo, hi, [&](const pair<const int,int>& item) {
+        seen.push_back(item);
+        return true;
+      });
+      ok = ok && n == expected.size() && seen == expected;
+
+      // returning false stops after that item, which is counted
+      size_t limit = rng() % 5 + 1;
+      seen.clear();
+      n = constTree.scan(lo, hi, [&](const pair<const int,int>& item) {
+        seen.push_back(item);
+        return seen.size() < limit;
+      });
+      ok = ok && n == min(limit, expected.size()) && Items(expected.begin(), expected.begin() + n) == seen;
+
+      // a buffer fills up to its capacity
+      pair<int,int> buffer[16];
+      size_t capacity = rng() % 16 + 1;
+      n = constTree.scan_into(lo, hi, buffer, capacity);
+      ok = ok && n == min(capacity, expected.size()) && Items(buffer, buffer + n) == Items(expected.begin(), expected.begin() + n);
+
+      // with flush, full blocks and then the rest cover the whole range
+      Items flushed;
+      size_t blocks = 0;
+      bool sizes = true;
+      n = constTree.scan_into(lo, hi, buffer, capacity, [&](const pair<int,int>* block, size_t count) {
+        sizes = sizes && count > 0 && count <= capacity && (flushed.size() % capacity == 0);
+        flushed.insert(flushed.end(), block, block + count);
+        blocks++;
+        return true;
+      });
+      ok = ok && sizes && n == expected.size() && flushed == expected &&
+           blocks == (expected.size() + capacity - 1) / capacity;
+    }
+    CHECK(ok);
+
+    // a flush returning false ends the scan after that block
+    pair<int,int> buffer[4];
+    size_t blocks = 0;
+    size_t n = constTree.scan_into(0, 3000, buffer, 4, [&](const pair<int,int>*, size_t) { return ++blocks < 2; });
+    CHECK(blocks == 2 && n == 8);
+    CHECK(constTree.scan_into(0, 3000, buffer, 0) == 0);
+
+    // lo == hi and lo > hi are empty, whatever lies between
+    CHECK(constTree.scan(10, 10, [](const pair<const int,int>&) { return true; }) == 0);
+    CHECK(constTree.scan(20, 10, [](const pair<const int,int>&) { return true; }) == 0);
+    Tree empty;
+    CHECK(empty.scan(0, 100, [](const pair<const int,int>&) { return true; }) == 0);
+}
+
+// a value whose copies start to throw once budget runs out
+static int g_copyBudget = -1;
+
+struct Fragile
+{
+    Fragile(int v = 0) : v(v) { }
+    Fragile(const Fragile& other) : v(other.v)
+    {
+      if(g_copyBudget == 0) throw runtime_error("copy failed");
+      if(g_copyBudget > 0) g_copyBudget--;
+    }
+    Fragile& operator=(const Fragile& other) = default;
+    int v;
+};
+
+ostream& operator<<(ostream& os, const Fragile& f)
+{
+    return os << f.v;
+}
+
+// a copy that throws midway leaves the target as it was
+template<typename Tree>
+void testThrowingCopy()
+{
+    Tree tree;
+    for(int i = 0; i < 2000; i++) tree.insert(make_pair(i, Fragile(i)));
+    Tree target;
+    target.insert(make_pair(7, Fragile(7)));
+
+    bool thrown = false;
+    g_copyBudget = 1000;
+    try {
+      target = tree;
+    }
+    catch(const runtime_error&) {
+      thrown = true;
+    }
+    g_copyBudget = 0;
+    try {
+      Tree copy(tree);
+      thrown = false;
+    }
+    catch(const runtime_error&) {
+    }
+    g_copyBudget = -1;
+    CHECK(thrown);
+    CHECK(target.size() == 1 && target.begin()->first == 7);
+    CHECK(tree.size() == 2000);
+}
+
+// the cursor walks the same sequence as the map in both directions, from
+// either end and from any lower_bound position
+template<typename Tree>
+void testCursor()
+{
+    Tree tree;
+    map<int,int> ref;
+    fill(tree, ref, 16, 2000);
+    // a sorted run makes long spines in the trees that do not rebalance
+    for(int i = 3000; i < 3400; i++) {
+      tree.insert(make_pair(i, i));
+      ref[i] = i;
+    }
+
+    typedef vector<pair<int,int> > Items;
+    Items expected(ref.begin(), ref.end());
+    Items forward, backward;
+    for(typename Tree::cursor c = tree.cursorBegin(); c != tree.cursorEnd(); ++c) forward.push_back(*c);
+    CHECK(forward == expected);
+    typename Tree::cursor c = tree.cursorEnd();
+    for(--c; c != tree.cursorEnd(); --c) backward.push_back(*c);
+    CHECK(Items(backward.rbegin(), backward.rend()) == expected);
+
+    // zig-zag from lower_bound positions
+    mt19937 rng(17);
+    bool ok = true;
+    for(int i = 0; i < 200; i++) {
+      int key = rng() % 3500;
+      typename Tree::cursor cur = tree.cursorLowerBound(key);
+      map<int,int>::const_iterator r = ref.lower_bound(key);
+      ok = ok && (r == ref.end() ? cur == tree.cursorEnd() : cur->first == r->first);
+      ok = ok && cur.position() == tree.lower_bound(key);
+      for(int k = 0; k < 20 && r != ref.end(); k++) {
+        if(rng() % 3 && r != ref.begin()) {
+          --cur;
+          --r;
+        }
+        else {
+          ++cur;
+          ++r;
+        }
+        ok = ok && (r == ref.end() ? cur == tree.cursorEnd() : cur->first == r->first);
+      }
+    }
+    CHECK(ok);
+
+    // from the end, ++ wraps to the first item and -- to the last
+    typename Tree::cursor wrap = tree.cursorEnd();
+    CHECK((++wrap)->first == ref.begin()->first);
+    wrap = tree.cursorEnd();
+    CHECK((--wrap)->first == ref.rbegin()->first);
+
+    Tree empty;
+    CHECK(empty.cursorBegin() == empty.cursorEnd());
+    CHECK(empty.cursorLowerBound(1) == empty.cursorEnd());
+}
+
+template<typename Tree>
+void testEngine()
+{
+    testCopyMoveSwap<Tree>();
+    testNodeHandles<Tree>();
+    testErase<Tree>();
+    testPriorityQueue<Tree>();
+    testRebalance<Tree>();
+    testIteration<Tree>();
+    testScans<Tree>();
+    testCursor<Tree>();
+}
+
+int main()
+{
+    testEngine<BinarySearchTree<int,int> >();
+    testEngine<AVLTree<int,int> >();
+    testEngine<RedBlackTree<int,int> >();
+    testEngine<SplayTree<int,int> >();
+    testEngine<ScapegoatTree<int,int> >();
+    testIncompatibleHandle();
+    testAutoRebalance();
+    testThrowingCopy<BinarySearchTree<int,Fragile> >();
+    testThrowingCopy<AVLTree<int,Fragile> >();
+    return checkResult("bst-features-test");
+}
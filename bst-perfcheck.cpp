@@ -0,0 +1,793 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include "bst.h"
+#include "avlbst.h"
+#include "tdavlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "scapegoatbst.h"
+#include "aggregatebst.h"
+#include "intervalbst.h"
+#include "multibst.h"
+#include "tree-shape.h"
+#include "parallel-bst.h"
+
+using namespace std;
+
+/*
+  Complexity regression suite.
+
+  Each check times one operation at doubling tree sizes, divides the
+  per-operation time by each candidate growth function and picks the
+  smallest class under which the normalized time stays flat.  A check
+  fails when that class is worse than the expected one, or when a
+  measurement sees a wrong result (missing keys, a failed verification,
+  a short copy and the like).  Classes below
+  the expected one pass, since constant and logarithmic costs cannot be
+  told apart reliably at these sizes.
+
+  usage: bst-perfcheck [--min-exp E] [--max-exp E] [--repeats R] [--verbose]
+*/
+
+enum Complexity { CONSTANT, LOGARITHMIC, LINEAR, LINEARITHMIC, QUADRATIC };
+
+static const char* complexityName(Complexity c)
+{
+    switch(c) {
+        case CONSTANT: return "O(1)";
+        case LOGARITHMIC: return "O(log n)";
+        case LINEAR: return "O(n)";
+        case LINEARITHMIC: return "O(n log n)";
+        default: return "O(n^2)";
+    }
+}
+
+static double growth(Complexity c, double n)
+{
+    switch(c) {
+        case CONSTANT: return 1.0;
+        case LOGARITHMIC: return log2(n);
+        case LINEAR: return n;
+        case LINEARITHMIC: return n * log2(n);
+        default: return n * n;
+    }
+}
+
+// Largest slope of log(time / f(n)) against log(n) still treated as flat.
+// Half of the gap between neighbouring polynomial classes: random probes
+// into trees that outgrow the caches drift by up to ~n^0.4, while a
+// regression by a full factor of n shows up as a slope near 1.
+static const double kFlatSlope = 0.5;
+
+typedef chrono::steady_clock Clock;
+
+// Wrong results seen by the measurements.  A check during which this grows
+// fails whatever its timing, so a correctness bug cannot pass as fast.
+static int g_wrongResults = 0;
+
+static ostream& wrongResult()
+{
+    g_wrongResults++;
+    return cerr << "wrong result: ";
+}
+
+static double secondsSince(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * One complexity check.  measure(n) builds whatever state it needs untimed
+ * and returns the time of a single operation at size n.
+ */
+struct Check
+{
+    string name;
+    Complexity expected;
+    function<double(uint64_t)> measure;
+};
+
+// ---------------------------------------------------------------------------
+// Key orders
+// ---------------------------------------------------------------------------
+
+// Keys 2, 4, ..., 2n in an order that builds a perfectly balanced
+// unbalanced-BST (breadth-first over the implicit midpoints).
+static vector<int> balancedOrder(uint64_t n)
+{
+    vector<int> keys;
+    keys.reserve(n);
+    vector<pair<uint64_t, uint64_t> > ranges(1, make_pair((uint64_t)0, n));
+    for(size_t i = 0; i < ranges.size(); i++) {
+        uint64_t lo = ranges[i].first, hi = ranges[i].second;
+        if(lo >= hi) continue;
+        uint64_t mid = lo + (hi - lo) / 2;
+        keys.push_back((int)(2 * (mid + 1)));
+        ranges.push_back(make_pair(lo, mid));
+        ranges.push_back(make_pair(mid + 1, hi));
+    }
+    return keys;
+}
+
+static vector<int> ascendingOrder(uint64_t n)
+{
+    vector<int> keys(n);
+    for(uint64_t i = 0; i < n; i++) keys[i] = (int)(2 * (i + 1));
+    return keys;
+}
+
+static vector<int> descendingOrder(uint64_t n)
+{
+    vector<int> keys = ascendingOrder(n);
+    reverse(keys.begin(), keys.end());
+    return keys;
+}
+
+// Alternates between the smallest and largest remaining key, which forces
+// double rotations on the way in.
+static vector<int> zigzagOrder(uint64_t n)
+{
+    vector<int> sorted = ascendingOrder(n), keys;
+    keys.reserve(n);
+    uint64_t lo = 0, hi = n;
+    while(lo < hi) {
+        keys.push_back(sorted[lo++]);
+        if(lo < hi) keys.push_back(sorted[--hi]);
+    }
+    return keys;
+}
+
+static vector<int> shuffled(vector<int> keys, uint64_t seed)
+{
+    mt19937_64 rng(seed);
+    shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+template<typename Tree>
+static void fill(Tree& tree, const vector<int>& keys)
+{
+    for(size_t i = 0; i < keys.size(); i++) tree.insert(make_pair(keys[i], keys[i]));
+}
+
+static uint64_t batchSize(uint64_t n)
+{
+    return std::max((uint64_t)1, std::min((uint64_t)1000, n / 4));
+}
+
+// ---------------------------------------------------------------------------
+// Measurements
+// ---------------------------------------------------------------------------
+
+template<typename Tree>
+static double timeFind(const vector<int>& order, uint64_t n)
+{
+    Tree tree;
+    fill(tree, order);
+    vector<int> probes = shuffled(ascendingOrder(n), n);
+    probes.resize(batchSize(n));
+    uint64_t hits = 0;
+    Clock::time_point start = Clock::now();
+    // non-const tree, so self-adjusting trees restructure as they would in use
+    for(size_t i = 0; i < probes.size(); i++) hits += tree.find(probes[i]) != tree.end();
+    double t = secondsSince(start);
+    if(hits != probes.size()) wrongResult() << "find missed keys" << endl;
+    return t / probes.size();
+}
+
+// Inserts a batch of fresh keys continuing the given order.
+template<typename Tree>
+static double timeInsert(const vector<int>& order, const vector<int>& extra)
+{
+    Tree tree;
+    fill(tree, order);
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < extra.size(); i++) tree.insert(make_pair(extra[i], extra[i]));
+    return secondsSince(start) / extra.size();
+}
+
+template<typename Tree>
+static double timeRemove(const vector<int>& order, const vector<int>& victims)
+{
+    Tree tree;
+    fill(tree, order);
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < victims.size(); i++) tree.remove(victims[i]);
+    return secondsSince(start) / victims.size();
+}
+
+template<typename Tree>
+static double timeIterate(const vector<int>& order)
+{
+    Tree tree;
+    fill(tree, order);
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) sum += it->first;
+    double t = secondsSince(start);
+    if(sum == 0) wrongResult() << "empty traversal" << endl;
+    return t / order.size();
+}
+
+// The newest count items, read from rbegin(), per item.
+template<typename Tree>
+static double timeLatest(const vector<int>& order, uint64_t count)
+{
+    Tree tree;
+    fill(tree, order);
+    const Tree& view = tree;
+    uint64_t sum = 0, seen = 0;
+    Clock::time_point start = Clock::now();
+    for(typename Tree::const_reverse_iterator it = view.rbegin(); it != view.rend() && seen < count; ++it, ++seen) sum += it->first;
+    double t = secondsSince(start);
+    if(sum == 0) wrongResult() << "empty traversal" << endl;
+    return t / count;
+}
+
+// Full-range scan() with a callback, per item.
+template<typename Tree>
+static double timeScan(const vector<int>& order)
+{
+    Tree tree;
+    fill(tree, order);
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    // ascendingOrder keys run from 2 to 2n
+    tree.scan(0, 2 * (int)order.size() + 1, [&](const pair<const int, int>& item) { sum += item.first; return true; });
+    double t = secondsSince(start);
+    if(sum == 0) wrongResult() << "empty traversal" << endl;
+    return t / order.size();
+}
+
+template<typename Tree>
+static double timeCursor(const vector<int>& order)
+{
+    Tree tree;
+    fill(tree, order);
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    for(typename Tree::cursor c = tree.cursorBegin(); c != tree.cursorEnd(); ++c) sum += c->first;
+    double t = secondsSince(start);
+    if(sum == 0) wrongResult() << "empty traversal" << endl;
+    return t / order.size();
+}
+
+template<typename Tree>
+static double timeClear(const vector<int>& order)
+{
+    Tree tree;
+    fill(tree, order);
+    Clock::time_point start = Clock::now();
+    tree.clear();
+    return secondsSince(start);
+}
+
+// Moves a batch of keys into a second tree through node handles.
+template<typename Tree>
+static double timeTransfer(const vector<int>& order, const vector<int>& keys)
+{
+    Tree from, to;
+    fill(from, order);
+    fill(to, order);
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < keys.size(); i++) to.insert(from.extract(keys[i]));
+    return secondsSince(start) / keys.size();
+}
+
+// Health-check queries (size, height, isBalanced), per query.
+template<typename Tree>
+static double timeStatistics(const vector<int>& order, uint64_t count)
+{
+    Tree tree;
+    fill(tree, order);
+    size_t sink = 0;
+    Clock::time_point start = Clock::now();
+    for(uint64_t i = 0; i < count; i++) sink += tree.size() + tree.height() + tree.isBalanced();
+    double t = secondsSince(start);
+    if(sink == 0) wrongResult() << "statistics of an empty tree" << endl;
+    return t / count;
+}
+
+// Parallel full verification, per node checked.
+template<typename Tree>
+static double timeVerify(const vector<int>& order, WorkStealingPool& pool)
+{
+    Tree tree;
+    fill(tree, order);
+    Clock::time_point start = Clock::now();
+    const char* violation = tree.verifyParallel(pool);
+    double t = secondsSince(start);
+    if(violation) wrongResult() << "verifyParallel: " << violation << endl;
+    return t / order.size();
+}
+
+// Parallel shape profile, per node visited.
+template<typename Tree>
+static double timeShape(const vector<int>& order, WorkStealingPool& pool)
+{
+    Tree tree;
+    fill(tree, order);
+    Clock::time_point start = Clock::now();
+    TreeShape shape = profileShape(tree.rootNode(), pool);
+    double t = secondsSince(start);
+    if(shape.nodes != tree.size()) wrongResult() << "profileShape: " << shape.nodes << " nodes, expected " << tree.size() << endl;
+    return t / order.size();
+}
+
+// Parallel in-order sum of the values, per item.
+template<typename Tree>
+static double timeParallelReduce(const vector<int>& order, WorkStealingPool& pool)
+{
+    Tree tree;
+    fill(tree, order);
+    Clock::time_point start = Clock::now();
+    long long sum = parallel_reduce(tree, 0LL,
+        [](long long acc, const pair<const int, int>& item) { return acc + item.second; },
+        [](long long a, long long b) { return a + b; }, pool);
+    double t = secondsSince(start);
+    long long expected = 0;
+    for(size_t i = 0; i < order.size(); i++) expected += order[i];
+    if(sum != expected) wrongResult() << "parallel_reduce: sum " << sum << ", expected " << expected << endl;
+    return t / order.size();
+}
+
+// One rebuild of the whole tree.
+template<typename Tree>
+static double timeRebalance(const vector<int>& order)
+{
+    Tree tree;
+    fill(tree, order);
+    Clock::time_point start = Clock::now();
+    tree.rebalance();
+    return secondsSince(start);
+}
+
+// Pops a batch of smallest items, per pop.
+template<typename Tree>
+static double timePopMin(const vector<int>& order, uint64_t count)
+{
+    Tree tree;
+    fill(tree, order);
+    Clock::time_point start = Clock::now();
+    for(uint64_t i = 0; i < count; i++) tree.pop_min();
+    return secondsSince(start) / count;
+}
+
+// Erases runs of up to 16 consecutive items starting at random keys.
+template<typename Tree>
+static double timeEraseRange(const vector<int>& order, const vector<int>& starts)
+{
+    Tree tree;
+    fill(tree, order);
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < starts.size(); i++) {
+        typename Tree::iterator first = tree.lower_bound(starts[i]), last = first;
+        for(int j = 0; j < 16 && last != tree.end(); j++) ++last;
+        tree.erase(first, last);
+    }
+    return secondsSince(start) / starts.size();
+}
+
+// Copy constructor, per node copied.
+template<typename Tree>
+static double timeCopy(const vector<int>& order)
+{
+    Tree tree;
+    fill(tree, order);
+    Clock::time_point start = Clock::now();
+    Tree copy(tree);
+    double t = secondsSince(start);
+    if(copy.size() != tree.size()) wrongResult() << "copy has " << copy.size() << " of " << tree.size() << " nodes" << endl;
+    return t / order.size();
+}
+
+// Range sums over random ranges that each span about half the keys.
+template<typename Tree>
+static double timeAggregate(const vector<int>& order, uint64_t n)
+{
+    Tree tree;
+    fill(tree, order);
+    mt19937_64 rng(n);
+    size_t queries = batchSize(n);
+    long long sum = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < queries; i++) {
+        int lo = (int)(rng() % n);
+        sum += tree.aggregate(lo, lo + (int)n);
+    }
+    double t = secondsSince(start);
+    if(sum == 0) wrongResult() << "empty aggregates" << endl;
+    return t / queries;
+}
+
+// Overlap queries against intervals [k, k+2] for every key k in order; each
+// query window [x, x+1] hits one or two of them.
+static double timeOverlapping(const vector<int>& order, uint64_t n)
+{
+    IntervalTree<int, int> tree;
+    for(size_t i = 0; i < order.size(); i++) tree.insert(order[i], order[i] + 2, (int)i);
+    vector<int> probes = shuffled(ascendingOrder(n), n);
+    probes.resize(batchSize(n));
+    vector<IntervalTree<int, int>::iterator> out;
+    size_t found = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < probes.size(); i++) {
+        out.clear();
+        found += tree.overlapping(probes[i] + 1, probes[i] + 2, out);
+    }
+    double t = secondsSince(start);
+    if(found < probes.size()) wrongResult() << "overlap query missed intervals" << endl;
+    return t / probes.size();
+}
+
+// Keys that fall strictly between the existing even keys.
+static vector<int> freshKeys(uint64_t n, uint64_t seed)
+{
+    vector<int> keys = shuffled(ascendingOrder(n), seed);
+    keys.resize(batchSize(n));
+    for(size_t i = 0; i < keys.size(); i++) keys[i] -= 1;
+    return keys;
+}
+
+// Keys past the end of an ascending (or below a descending) build.
+static vector<int> continueOrder(uint64_t n, bool ascending)
+{
+    vector<int> keys(batchSize(n));
+    for(size_t i = 0; i < keys.size(); i++)
+        keys[i] = ascending ? (int)(2 * (n + i + 1)) : -(int)(2 * (i + 1));
+    return keys;
+}
+
+static vector<int> prefix(const vector<int>& keys, uint64_t count)
+{
+    return vector<int>(keys.begin(), keys.begin() + std::min((size_t)count, keys.size()));
+}
+
+static vector<Check> makeChecks()
+{
+    typedef BinarySearchTree<int, int> BST;
+    typedef AVLTree<int, int> AVL;
+    typedef TopDownAVLTree<int, int> TDAVL;
+    typedef RedBlackTree<int, int> RB;
+    typedef SplayTree<int, int> Splay;
+    typedef ScapegoatTree<int, int> Scapegoat;
+    typedef AggregateAVLTree<int, int, SumAggregate<long long> > SumAVL;
+    typedef MultiAVLTree<int, int> MultiAVL;
+    vector<Check> checks;
+
+    Check c;
+    c.name = "BST find (balanced build)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeFind<BST>(balancedOrder(n), n); };
+    checks.push_back(c);
+
+    c.name = "BST insert (balanced build)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeInsert<BST>(balancedOrder(n), freshKeys(n, 1)); };
+    checks.push_back(c);
+
+    c.name = "BST remove (balanced build)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeRemove<BST>(balancedOrder(n), prefix(shuffled(ascendingOrder(n), 2), batchSize(n)));
+    };
+    checks.push_back(c);
+
+    c.name = "BST iterator++ (full scan)";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) { return timeIterate<BST>(balancedOrder(n)); };
+    checks.push_back(c);
+
+    c.name = "BST clear";
+    c.expected = LINEAR;
+    c.measure = [](uint64_t n) { return timeClear<BST>(balancedOrder(n)); };
+    checks.push_back(c);
+
+    c.name = "AVL find (ascending build)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeFind<AVL>(ascendingOrder(n), n); };
+    checks.push_back(c);
+
+    c.name = "AVL insert (ascending)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeInsert<AVL>(ascendingOrder(n), continueOrder(n, true)); };
+    checks.push_back(c);
+
+    c.name = "AVL insert (descending)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeInsert<AVL>(descendingOrder(n), continueOrder(n, false)); };
+    checks.push_back(c);
+
+    c.name = "AVL insert (zig-zag)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeInsert<AVL>(zigzagOrder(n), freshKeys(n, 3)); };
+    checks.push_back(c);
+
+    c.name = "AVL insert (random)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeInsert<AVL>(shuffled(ascendingOrder(n), 4), freshKeys(n, 5));
+    };
+    checks.push_back(c);
+
+    c.name = "AVL remove (ascending)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeRemove<AVL>(ascendingOrder(n), prefix(ascendingOrder(n), batchSize(n)));
+    };
+    checks.push_back(c);
+
+    c.name = "AVL remove (descending)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeRemove<AVL>(ascendingOrder(n), prefix(descendingOrder(n), batchSize(n)));
+    };
+    checks.push_back(c);
+
+    c.name = "AVL remove (random)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeRemove<AVL>(zigzagOrder(n), prefix(shuffled(ascendingOrder(n), 6), batchSize(n)));
+    };
+    checks.push_back(c);
+
+    c.name = "AVL iterator++ (full scan)";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) { return timeIterate<AVL>(ascendingOrder(n)); };
+    checks.push_back(c);
+
+    c.name = "AVL rbegin (latest items)";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) { return timeLatest<AVL>(shuffled(ascendingOrder(n), 30), batchSize(n)); };
+    checks.push_back(c);
+
+    c.name = "AVL scan (full range)";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) { return timeScan<AVL>(ascendingOrder(n)); };
+    checks.push_back(c);
+
+    c.name = "AVL cursor++ (full scan)";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) { return timeCursor<AVL>(ascendingOrder(n)); };
+    checks.push_back(c);
+
+    c.name = "AVL clear";
+    c.expected = LINEAR;
+    c.measure = [](uint64_t n) { return timeClear<AVL>(ascendingOrder(n)); };
+    checks.push_back(c);
+
+    c.name = "TD-AVL insert (ascending)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeInsert<TDAVL>(ascendingOrder(n), continueOrder(n, true)); };
+    checks.push_back(c);
+
+    c.name = "TD-AVL remove (random)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeRemove<TDAVL>(zigzagOrder(n), prefix(shuffled(ascendingOrder(n), 7), batchSize(n)));
+    };
+    checks.push_back(c);
+
+    c.name = "TD-AVL iterator++ (full scan)";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) { return timeIterate<TDAVL>(ascendingOrder(n)); };
+    checks.push_back(c);
+
+    c.name = "RB insert (ascending)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeInsert<RB>(ascendingOrder(n), continueOrder(n, true)); };
+    checks.push_back(c);
+
+    c.name = "RB remove (random)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeRemove<RB>(zigzagOrder(n), prefix(shuffled(ascendingOrder(n), 8), batchSize(n)));
+    };
+    checks.push_back(c);
+
+    // splay costs are amortized, so these time whole random batches
+    c.name = "Splay find (random batch)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeFind<Splay>(shuffled(ascendingOrder(n), 9), n); };
+    checks.push_back(c);
+
+    c.name = "Splay insert (random)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeInsert<Splay>(shuffled(ascendingOrder(n), 10), freshKeys(n, 11));
+    };
+    checks.push_back(c);
+
+    // rebuilds are amortized over the batch
+    c.name = "Scapegoat insert (ascending)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeInsert<Scapegoat>(ascendingOrder(n), continueOrder(n, true));
+    };
+    checks.push_back(c);
+
+    c.name = "Scapegoat remove (random)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeRemove<Scapegoat>(zigzagOrder(n), prefix(shuffled(ascendingOrder(n), 12), batchSize(n)));
+    };
+    checks.push_back(c);
+
+    c.name = "Aggregate AVL insert (random)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeInsert<SumAVL>(shuffled(ascendingOrder(n), 13), freshKeys(n, 14));
+    };
+    checks.push_back(c);
+
+    c.name = "Aggregate AVL range sum";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeAggregate<SumAVL>(shuffled(ascendingOrder(n), 15), n); };
+    checks.push_back(c);
+
+    c.name = "Interval overlapping (k <= 2)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timeOverlapping(shuffled(ascendingOrder(n), 16), n); };
+    checks.push_back(c);
+
+    c.name = "AVL extract + insert (handle)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeTransfer<AVL>(shuffled(ascendingOrder(n), 20), prefix(shuffled(ascendingOrder(n), 21), batchSize(n)));
+    };
+    checks.push_back(c);
+
+    c.name = "AVL erase range (16 items)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeEraseRange<AVL>(shuffled(ascendingOrder(n), 22), prefix(shuffled(ascendingOrder(n), 23), batchSize(n) / 16 + 1));
+    };
+    checks.push_back(c);
+
+    c.name = "AVL pop_min";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) { return timePopMin<AVL>(shuffled(ascendingOrder(n), 24), batchSize(n)); };
+    checks.push_back(c);
+
+    c.name = "AVL size/height/isBalanced";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) { return timeStatistics<AVL>(shuffled(ascendingOrder(n), 26), batchSize(n)); };
+    checks.push_back(c);
+
+    c.name = "AVL verifyParallel (per node)";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) {
+        static WorkStealingPool pool;
+        return timeVerify<AVL>(shuffled(ascendingOrder(n), 27), pool);
+    };
+    checks.push_back(c);
+
+    c.name = "AVL shape profile (per node)";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) {
+        static WorkStealingPool pool;
+        return timeShape<AVL>(shuffled(ascendingOrder(n), 28), pool);
+    };
+    checks.push_back(c);
+
+    c.name = "AVL parallel_reduce (per item)";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) {
+        static WorkStealingPool pool;
+        return timeParallelReduce<AVL>(shuffled(ascendingOrder(n), 29), pool);
+    };
+    checks.push_back(c);
+
+    c.name = "BST rebalance";
+    c.expected = LINEAR;
+    c.measure = [](uint64_t n) { return timeRebalance<BST>(shuffled(ascendingOrder(n), 25)); };
+    checks.push_back(c);
+
+    c.name = "AVL copy (per node)";
+    c.expected = CONSTANT;
+    c.measure = [](uint64_t n) { return timeCopy<AVL>(shuffled(ascendingOrder(n), 19)); };
+    checks.push_back(c);
+
+    c.name = "Multi AVL insert (duplicates)";
+    c.expected = LOGARITHMIC;
+    c.measure = [](uint64_t n) {
+        return timeInsert<MultiAVL>(shuffled(ascendingOrder(n), 17), prefix(shuffled(ascendingOrder(n), 18), batchSize(n)));
+    };
+    checks.push_back(c);
+
+    return checks;
+}
+
+// ---------------------------------------------------------------------------
+// Classification
+// ---------------------------------------------------------------------------
+
+// Least-squares slope of log(t / f(n)) against log(n).
+static double residualSlope(const vector<double>& sizes, const vector<double>& times, Complexity c)
+{
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    size_t m = sizes.size();
+    for(size_t i = 0; i < m; i++) {
+        double x = log(sizes[i]);
+        double y = log(times[i] / growth(c, sizes[i]));
+        sx += x; sy += y; sxx += x * x; sxy += x * y;
+    }
+    return (m * sxy - sx * sy) / (m * sxx - sx * sx);
+}
+
+static Complexity classify(const vector<double>& sizes, const vector<double>& times, double& slope)
+{
+    for(int c = CONSTANT; c < QUADRATIC; c++) {
+        slope = residualSlope(sizes, times, (Complexity)c);
+        if(slope <= kFlatSlope) return (Complexity)c;
+    }
+    slope = residualSlope(sizes, times, QUADRATIC);
+    return QUADRATIC;
+}
+
+int main(int argc, char* argv[])
+{
+    int minExp = 10, maxExp = 18, repeats = 5;
+    bool verbose = false;
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--min-exp" && hasValue) minExp = atoi(argv[++i]);
+        else if(arg == "--max-exp" && hasValue) maxExp = atoi(argv[++i]);
+        else if(arg == "--repeats" && hasValue) repeats = atoi(argv[++i]);
+        else if(arg == "--verbose") verbose = true;
+        else {
+            cerr << "usage: " << argv[0] << " [--min-exp E] [--max-exp E] [--repeats R] [--verbose]"
+                 << endl;
+            return 1;
+        }
+    }
+    if(maxExp - minExp < 2 || repeats < 1) {
+        cerr << "need at least three sizes and one repeat" << endl;
+        return 1;
+    }
+
+    vector<Check> checks = makeChecks();
+    int failures = 0;
+    for(size_t ci = 0; ci < checks.size(); ci++) {
+        const Check& check = checks[ci];
+        int wrongBefore = g_wrongResults;
+        vector<double> sizes, times;
+        for(int e = minExp; e <= maxExp; e++) {
+            uint64_t n = (uint64_t)1 << e;
+            // the minimum over repeats filters out scheduling noise
+            double best = 0;
+            for(int r = 0; r < repeats; r++) {
+                double t = check.measure(n);
+                if(r == 0 || t < best) best = t;
+            }
+            sizes.push_back((double)n);
+            times.push_back(std::max(best, 1e-12));
+            if(verbose) {
+                cout << "  " << check.name << " n=" << n << " " << best * 1e9 << " ns" << endl;
+            }
+        }
+        double slope;
+        Complexity measured = classify(sizes, times, slope);
+        bool correct = g_wrongResults == wrongBefore;
+        bool ok = correct && measured <= check.expected;
+        if(!ok) failures++;
+        cout << left << setw(30) << check.name << " expected " << setw(11)
+             << complexityName(check.expected) << " measured " << setw(11)
+             << complexityName(measured) << " slope " << fixed << setprecision(2) << setw(6)
+             << slope << (ok ? " PASS" : correct ? " FAIL" : " FAIL (wrong results)") << endl;
+    }
+
+    cout << (failures ? "perfcheck FAILED: " : "perfcheck passed: ")
+         << checks.size() - failures << "/" << checks.size() << " checks" << endl;
+    return failures ? 1 : 0;
+}
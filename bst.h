@@ -3,10 +3,24 @@
 
 #include <iostream>
 #include <exception>
+#include <stdexcept>
 #include <cstdlib>
 #include <utility>
 #include <cmath>
 #include <algorithm>
+#include <thread>
+#include <system_error>
+#include <vector>
+#include <iterator>
+#include <cstddef>
+#include "keycompare.h"
+#include "keyhead.h"
+
+/**
+* Subtrees whose outer spines are both at least this long are big enough to be
+* copied on their own thread.
+*/
+#define BST_PARALLEL_CLONE_DEPTH 14
 
 /**
  * A templated class for a Node in a search tree.
@@ -14,14 +28,20 @@
  * that they can be overridden for future kinds of
  * search trees, such as Red Black trees, Splay trees,
  * and AVL trees.
+ * For std::string keys the KeyHead base also caches the
+ * key's first 8 bytes (see keyhead.h).
  */
 template <typename Key, typename Value>
-class Node
+class Node : public KeyHead<Key>
 {
 public:
     Node(const Key& key, const Value& value, Node<Key, Value>* parent);
     virtual ~Node();
 
+    // Copies the node, including any state a derived node adds; the copy's
+    // links still point into the original tree until the caller resets them
+    virtual Node<Key, Value>* clone() const;
+
     const std::pair<const Key, Value>& getItem() const;
     std::pair<const Key, Value>& getItem();
     const Key& getKey() const;
@@ -55,6 +75,7 @@ protected:
 */
 template<typename Key, typename Value>
 Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) :
+    KeyHead<Key>(key),
     item_(key, value),
     parent_(parent),
     left_(NULL),
@@ -74,6 +95,12 @@ Node<Key, Value>::~Node()
 
 }
 
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::clone() const
+{
+    return new Node<Key, Value>(*this);
+}
+
 /**
 * A const getter for the item.
 */
@@ -188,31 +215,160 @@ void Node<Key, Value>::setValue(const Value& value)
   ---------------------------------------
 */
 
+template <typename Key, typename Value, typename Compare>
+class BinarySearchTree;
+
+// defined in work-stealing-pool.h, which only parallel-bst.h needs
+class WorkStealingPool;
+
 /**
-* A templated unbalanced binary search tree.
+* Owns one node taken out of a tree by extract(), so it can be inserted into
+* another tree without freeing and reallocating it.  Handles are move-only;
+* a handle that still owns its node frees it on destruction.
 */
 template <typename Key, typename Value>
+class NodeHandle
+{
+public:
+    NodeHandle();
+    NodeHandle(NodeHandle&& other);
+    NodeHandle& operator=(NodeHandle&& other);
+    ~NodeHandle();
+
+    bool empty() const;
+    explicit operator bool() const;
+    // precondition: the handle is not empty
+    const Key& key() const;
+    Value& mapped() const;
+
+protected:
+    template<typename K, typename V, typename C> friend class BinarySearchTree;
+    explicit NodeHandle(Node<Key, Value>* node);
+
+    Node<Key, Value>* node_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the NodeHandle class.
+  -----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>::NodeHandle() : node_(NULL)
+{
+
+}
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>::NodeHandle(Node<Key, Value>* node) : node_(node)
+{
+
+}
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>::NodeHandle(NodeHandle&& other) : node_(other.node_)
+{
+    other.node_ = NULL;
+}
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>& NodeHandle<Key, Value>::operator=(NodeHandle&& other)
+{
+    if(this != &other) {
+        delete node_;
+        node_ = other.node_;
+        other.node_ = NULL;
+    }
+    return *this;
+}
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>::~NodeHandle()
+{
+    delete node_;
+}
+
+template<typename Key, typename Value>
+bool NodeHandle<Key, Value>::empty() const
+{
+    return node_ == NULL;
+}
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>::operator bool() const
+{
+    return node_ != NULL;
+}
+
+template<typename Key, typename Value>
+const Key& NodeHandle<Key, Value>::key() const
+{
+    return node_->getKey();
+}
+
+template<typename Key, typename Value>
+Value& NodeHandle<Key, Value>::mapped() const
+{
+    return node_->getValue();
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the NodeHandle class.
+  ---------------------------------------------
+*/
+
+/**
+* A templated unbalanced binary search tree.
+*
+* Compare is either a less-than predicate returning bool (the default
+* std::less<Key>) or a three-way comparator returning int, such as
+* ThreeWayCompare (see keycompare.h).  Comparators with an is_transparent
+* typedef also enable find() with keys of other types.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
 class BinarySearchTree
 {
 public:
-    BinarySearchTree(); //TODO
-    virtual ~BinarySearchTree(); //TODO
-    virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
-    virtual void remove(const Key& key); //TODO
-    void clear(); //TODO
-    bool isBalanced() const; //TODO
+    BinarySearchTree();
+    explicit BinarySearchTree(const Compare& comp);
+    BinarySearchTree(const BinarySearchTree& other);
+    BinarySearchTree(BinarySearchTree&& other);
+    virtual ~BinarySearchTree();
+    BinarySearchTree& operator=(const BinarySearchTree& other);
+    BinarySearchTree& operator=(BinarySearchTree&& other);
+    void swap(BinarySearchTree& other);
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    void clear();
+    virtual bool isBalanced() const;
     void print() const;
     bool empty() const;
+    size_t size() const;
 
-    template<typename PPKey, typename PPValue>
-    friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
+    template<typename PPKey, typename PPValue, typename PPCompare>
+    friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue, PPCompare> & tree);
+    // parallel-bst.h; it splits the tree at root_
+    template<typename K, typename V, typename C, typename Function>
+    friend void parallel_for_each(BinarySearchTree<K, V, C>& tree, Function fn, WorkStealingPool& pool);
 public:
+    class const_iterator;
+
     /**
     * An internal iterator class for traversing the contents of the BST.
+    * It is bidirectional: -- steps through predecessor(), and --end() is
+    * the largest item, which is why it also remembers its tree.
     */
-    class iterator  // TODO
+    class iterator
     {
     public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::pair<const Key,Value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef std::pair<const Key,Value>* pointer;
+        typedef std::pair<const Key,Value>& reference;
+
         iterator();
 
         std::pair<const Key,Value>& operator*() const;
@@ -220,47 +376,253 @@ public:
 
         bool operator==(const iterator& rhs) const;
         bool operator!=(const iterator& rhs) const;
+        bool operator==(const const_iterator& rhs) const;
+        bool operator!=(const const_iterator& rhs) const;
 
         iterator& operator++();
+        iterator& operator--();
 
     protected:
-        friend class BinarySearchTree<Key, Value>;
-        iterator(Node<Key,Value>* ptr);
+        friend class BinarySearchTree<Key, Value, Compare>;
+        friend class const_iterator;
+        iterator(Node<Key,Value>* ptr, const BinarySearchTree<Key, Value, Compare>* tree);
         Node<Key, Value> *current_;
+        const BinarySearchTree<Key, Value, Compare>* tree_;
+    };
+
+    /**
+    * The same walk as iterator with read-only access to the items.  An
+    * iterator converts to a const_iterator, not the other way round.
+    */
+    class const_iterator
+    {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::pair<const Key,Value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const std::pair<const Key,Value>* pointer;
+        typedef const std::pair<const Key,Value>& reference;
+
+        const_iterator();
+        const_iterator(const iterator& it);
+
+        const std::pair<const Key,Value>& operator*() const;
+        const std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const const_iterator& rhs) const;
+        bool operator!=(const const_iterator& rhs) const;
+
+        const_iterator& operator++();
+        const_iterator& operator--();
+
+    protected:
+        friend class BinarySearchTree<Key, Value, Compare>;
+        const_iterator(Node<Key,Value>* ptr, const BinarySearchTree<Key, Value, Compare>* tree);
+        Node<Key, Value> *current_;
+        const BinarySearchTree<Key, Value, Compare>* tree_;
+    };
+
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    /**
+    * A bidirectional cursor for long scans.  It keeps the path from the root
+    * to its node, and each entry records where the path last turned left and
+    * right, so a step up to the next item is one truncation of the path in
+    * O(1), never a climb through getParent().  A step down to the next item
+    * pushes the spine it walks, which is O(height) for one step: the nodes
+    * keep no threads, so the next item can sit at the end of a spine no
+    * earlier step has seen.  Over a scan every node is pushed once, so steps
+    * are O(1) amortized.  After each step the cursor prefetches the child
+    * the next step in the same direction will visit.  Any insert or remove
+    * invalidates it.
+    */
+    class cursor
+    {
+    public:
+        cursor();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const cursor& rhs) const;
+        bool operator!=(const cursor& rhs) const;
+
+        // stepping off either end gives the end cursor; from the end, ++
+        // moves to the first item and -- to the last
+        cursor& operator++();
+        cursor& operator--();
+
+        // the same position as an iterator, end() at the end
+        iterator position() const;
+
+    protected:
+        friend class BinarySearchTree<Key, Value, Compare>;
+        explicit cursor(const BinarySearchTree<Key, Value, Compare>* tree);
+        void push(Node<Key, Value>* n, bool left);
+        void pushLeftmost(Node<Key, Value>* n);
+        void pushRightmost(Node<Key, Value>* n);
+        static void prefetch(const Node<Key, Value>* n);
+
+        // a node on the path and the path lengths up to its nearest ancestors
+        // it is left / right of (0 if none), i.e. its successor / predecessor
+        // when it has no right / left child
+        struct Frame
+        {
+            Node<Key, Value>* node;
+            size_t leftOf;
+            size_t rightOf;
+        };
+
+        const BinarySearchTree<Key, Value, Compare>* tree_;
+        // root first, the cursor's node last; empty at the end
+        std::vector<Frame> path_;
     };
 
 public:
-    iterator begin() const;
-    iterator end() const;
-    iterator find(const Key& key) const;
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator cbegin() const;
+    const_iterator cend() const;
+    // Descending order; a reverse scan from any position p starts at
+    // reverse_iterator(p) and costs O(log n + k) for k items
+    reverse_iterator rbegin();
+    reverse_iterator rend();
+    const_reverse_iterator rbegin() const;
+    const_reverse_iterator rend() const;
+    cursor cursorBegin() const;
+    cursor cursorEnd() const;
+    cursor cursorLowerBound(const Key& key) const;
+    iterator find(const Key& key);
+    const_iterator find(const Key& key) const;
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator find(const K& key);
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    const_iterator find(const K& key) const;
+    iterator lower_bound(const Key& key);
+    const_iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key);
+    const_iterator upper_bound(const Key& key) const;
+    std::pair<iterator, iterator> equal_range(const Key& key);
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const;
+    size_t count(const Key& key) const;
+
+    // Range scans over the items with lo <= key < hi, in key order, run as
+    // one internal traversal instead of an iterator step per item.  scan()
+    // passes each item to callback(item) and stops after the first false;
+    // it returns the number of items passed.  scan_into() copies items into
+    // buffer and returns how many it wrote, at most capacity; with flush it
+    // refills buffer for the whole range and calls flush(buffer, count)
+    // for every full block and the last one, stopping if flush returns
+    // false.
+    template<typename Callback>
+    size_t scan(const Key& lo, const Key& hi, Callback callback) const;
+    size_t scan_into(const Key& lo, const Key& hi, std::pair<Key, Value>* buffer, size_t capacity) const;
+    template<typename Flush>
+    size_t scan_into(const Key& lo, const Key& hi, std::pair<Key, Value>* buffer, size_t capacity,
+                     Flush flush) const;
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
 
+    // Node handles: move single nodes between trees of the same type
+    typedef NodeHandle<Key, Value> node_type;
+    node_type extract(const Key& key);
+    node_type extract(iterator pos);
+    iterator insert(node_type&& nh);
+
+    // Removes the item at pos (or every item in [first, last)) and returns
+    // an iterator to the item after it
+    iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
+
+    // Double-ended priority queue: the smallest and largest items (end()
+    // if empty) in O(1), and their removal without a search
+    iterator min();
+    iterator max();
+    const_iterator min() const;
+    const_iterator max() const;
+    void pop_min();
+    void pop_max();
+
+    // Rebuilds the tree into a perfectly balanced shape in O(n) time and
+    // O(1) extra memory (Day-Stout-Warren).  Iterators stay valid.
+    virtual void rebalance();
+    // Makes insert() call rebalance() once a new leaf lands deeper than
+    // factor * log2(n); 0 turns it off.  Only the unbalanced trees use it.
+    void setAutoRebalance(double factor);
+
+    // read-only access to the nodes for analysis passes (e.g. profileShape
+    // in tree-shape.h)
+    const Node<Key, Value>* rootNode() const;
+
 protected:
     // Mandatory helper functions
-    Node<Key, Value>* internalFind(const Key& k) const; // TODO
-    Node<Key, Value> *getSmallestNode() const;  // TODO
-    Node<Key, Value> *getLargestNode() const; // TODO
-    static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
-    static Node<Key, Value>* successor(Node<Key, Value>* current); // TODO
+    template<typename K>
+    Node<Key, Value>* internalFind(const K& k) const;
+    Node<Key, Value> *getSmallestNode() const;
+    Node<Key, Value> *getLargestNode() const;
+    static Node<Key, Value>* predecessor(Node<Key, Value>* current);
+    static Node<Key, Value>* successor(Node<Key, Value>* current);
     // Note:  static means these functions don't have a "this" pointer
     //        and instead just use the input argument.
 
+    // Wraps a node for derived trees, which cannot use iterator's constructor
+    iterator makeIterator(Node<Key, Value>* n) const;
+    const_iterator makeConstIterator(Node<Key, Value>* n) const;
+    Node<Key, Value>* lowerBoundNode(const Key& key) const;
+    Node<Key, Value>* upperBoundNode(const Key& key) const;
+    template<typename Visit>
+    size_t scanRange(const Key& lo, const Key& hi, Visit& visit) const;
+
     // Provided helper functions
     virtual void printRoot (Node<Key, Value> *r) const;
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
+    void rotateRight(Node<Key, Value>* n);
+    void rotateLeft(Node<Key, Value>* n);
 
     // Add helper functions here
+    template<typename A, typename B>
+    int compareKeys(const A& a, const B& b) const;
     static Node<Key, Value> *getSmallestNodeOfTree(Node<Key,Value>* root); 
     static Node<Key, Value> *getLargestNodeOfTree(Node<Key,Value>* root); 
-    static Node<Key, Value>* insertHelper(Node<Key, Value>* current, const std::pair<const Key, Value>& keyValuePair);
+    Node<Key, Value>* insertHelper(Node<Key, Value>* current, const std::pair<const Key, Value>& keyValuePair);
     virtual void removeHelper(Node<Key, Value>* current, const Key& key);
+    Node<Key, Value>* unlinkNode(Node<Key, Value>* current);
+    Node<Key, Value>* descend(const Key& key, Node<Key, Value>*& parent, int& c) const;
+    virtual Node<Key, Value>* detachNode(Node<Key, Value>* n);
+    virtual Node<Key, Value>* attachNode(Node<Key, Value>* n);
+    virtual bool isCompatibleNode(const Node<Key, Value>* n) const;
+    virtual void eraseRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    virtual void splitAround(Node<Key, Value>* x, Node<Key, Value>*& lo, Node<Key, Value>*& hi);
+    virtual Node<Key, Value>* joinAround(Node<Key, Value>* lo, Node<Key, Value>* k, Node<Key, Value>* hi);
     static int isBalancedHelper(Node<Key, Value>* current); 
-    void clearHelper(Node<Key, Value>* current); 
+    static size_t clearHelper(Node<Key, Value>* current); 
+    void leafInserted(size_t depth);
+    size_t treeToVine();
+    void compressVine(size_t count);
+    void leafLinked(Node<Key, Value>* n);
+    void nodeLeaving(Node<Key, Value>* n);
+    void resetExtremes();
+    // called by clear() once the tree is empty, for derived bookkeeping
+    virtual void cleared();
+    static Node<Key, Value>* cloneSubtree(const Node<Key, Value>* src, unsigned threads);
+    static Node<Key, Value>* cloneNode(const Node<Key, Value>* src, Node<Key, Value>* parent);
+    static bool isLargeSubtree(const Node<Key, Value>* n);
+    static unsigned cloneThreads();
 
 
 protected:
     Node<Key, Value>* root_;
+    // cached smallest and largest nodes, NULL when empty
+    Node<Key, Value>* leftmost_;
+    Node<Key, Value>* rightmost_;
+    // number of items, and the auto-rebalance state (see leafInserted)
+    size_t count_;
+    double autoRebalance_;
+    size_t insertsSinceRebalance_;
+    Compare comp_;
     // You should not need other data members
 };
 
@@ -273,29 +635,30 @@ Begin implementations for the BinarySearchTree::iterator class.
 /**
 * Explicit constructor that initializes an iterator with a given node pointer.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator(Node<Key,Value> *ptr,
+    const BinarySearchTree<Key, Value, Compare>* tree)
 {
-    // TODO
     current_ = ptr; 
+    tree_ = tree; 
 }
 
 /**
 * A default constructor that initializes the iterator to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator() 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator() 
 {
     current_ = nullptr;
-
+    tree_ = nullptr; 
 }
 
 /**
 * Provides access to the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 std::pair<const Key,Value> &
-BinarySearchTree<Key, Value>::iterator::operator*() const
+BinarySearchTree<Key, Value, Compare>::iterator::operator*() const
 {
     return current_->getItem();
 }
@@ -303,9 +666,9 @@ BinarySearchTree<Key, Value>::iterator::operator*() const
 /**
 * Provides access to the address of the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 std::pair<const Key,Value> *
-BinarySearchTree<Key, Value>::iterator::operator->() const
+BinarySearchTree<Key, Value, Compare>::iterator::operator->() const
 {
     return &(current_->getItem());
 }
@@ -314,10 +677,10 @@ BinarySearchTree<Key, Value>::iterator::operator->() const
 * Checks if 'this' iterator's internals have the same value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 bool
-BinarySearchTree<Key, Value>::iterator::operator==(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare>::iterator::operator==(
+    const BinarySearchTree<Key, Value, Compare>::iterator& rhs) const
 {
     return this->current_ == rhs.current_; 
 }
@@ -326,28 +689,57 @@ BinarySearchTree<Key, Value>::iterator::operator==(
 * Checks if 'this' iterator's internals have a different value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 bool
-BinarySearchTree<Key, Value>::iterator::operator!=(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare>::iterator::operator!=(
+    const BinarySearchTree<Key, Value, Compare>::iterator& rhs) const
 {
     return this->current_ != rhs.current_; 
 
 }
 
+template<class Key, class Value, class Compare>
+bool
+BinarySearchTree<Key, Value, Compare>::iterator::operator==(
+    const BinarySearchTree<Key, Value, Compare>::const_iterator& rhs) const
+{
+    return this->current_ == rhs.current_; 
+}
+
+template<class Key, class Value, class Compare>
+bool
+BinarySearchTree<Key, Value, Compare>::iterator::operator!=(
+    const BinarySearchTree<Key, Value, Compare>::const_iterator& rhs) const
+{
+    return this->current_ != rhs.current_; 
+}
+
 
 /**
 * Advances the iterator's location using an in-order sequencing
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator&
-BinarySearchTree<Key, Value>::iterator::operator++()
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator&
+BinarySearchTree<Key, Value, Compare>::iterator::operator++()
 {
     current_ = successor(current_); 
     return *this; 
 
 }
 
+/**
+* Moves back to the previous item; from end() that is the largest item,
+* which the tree caches, and before the first item it is end() again
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator&
+BinarySearchTree<Key, Value, Compare>::iterator::operator--()
+{
+    if(current_) current_ = predecessor(current_); 
+    else if(tree_) current_ = tree_->rightmost_; 
+    return *this; 
+}
+
 
 /*
 -------------------------------------------------------------
@@ -355,6 +747,246 @@ End implementations for the BinarySearchTree::iterator class.
 -------------------------------------------------------------
 */
 
+/*
+-------------------------------------------------------------------
+Begin implementations for the BinarySearchTree::const_iterator class.
+-------------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::const_iterator::const_iterator(Node<Key,Value> *ptr,
+    const BinarySearchTree<Key, Value, Compare>* tree) :
+    current_(ptr),
+    tree_(tree)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::const_iterator::const_iterator() :
+    current_(nullptr),
+    tree_(nullptr)
+{
+
+}
+
+/**
+* Every iterator converts implicitly, so const_iterator parameters accept
+* both.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::const_iterator::const_iterator(const iterator& it) :
+    current_(it.current_),
+    tree_(it.tree_)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+const std::pair<const Key,Value> &
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator*() const
+{
+    return current_->getItem(); 
+}
+
+template<class Key, class Value, class Compare>
+const std::pair<const Key,Value> *
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator->() const
+{
+    return &(current_->getItem()); 
+}
+
+template<class Key, class Value, class Compare>
+bool
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator==(const const_iterator& rhs) const
+{
+    return current_ == rhs.current_; 
+}
+
+template<class Key, class Value, class Compare>
+bool
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator!=(const const_iterator& rhs) const
+{
+    return current_ != rhs.current_; 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator&
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator++()
+{
+    current_ = successor(current_); 
+    return *this; 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator&
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator--()
+{
+    if(current_) current_ = predecessor(current_); 
+    else if(tree_) current_ = tree_->rightmost_; 
+    return *this; 
+}
+
+/*
+-----------------------------------------------------------------
+End implementations for the BinarySearchTree::const_iterator class.
+-----------------------------------------------------------------
+*/
+
+/*
+-------------------------------------------------------------
+Begin implementations for the BinarySearchTree::cursor class.
+-------------------------------------------------------------
+*/
+
+/**
+* A default constructor for a cursor that belongs to no tree.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::cursor::cursor() :
+    tree_(nullptr)
+{
+
+}
+
+/**
+* A cursor at the end of tree.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::cursor::cursor(const BinarySearchTree<Key, Value, Compare>* tree) :
+    tree_(tree)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value> &
+BinarySearchTree<Key, Value, Compare>::cursor::operator*() const
+{
+    return path_.back().node->getItem(); 
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value> *
+BinarySearchTree<Key, Value, Compare>::cursor::operator->() const
+{
+    return &(path_.back().node->getItem()); 
+}
+
+template<class Key, class Value, class Compare>
+bool
+BinarySearchTree<Key, Value, Compare>::cursor::operator==(const cursor& rhs) const
+{
+    if(path_.empty() || rhs.path_.empty()) return path_.empty() && rhs.path_.empty(); 
+    return path_.back().node == rhs.path_.back().node; 
+}
+
+template<class Key, class Value, class Compare>
+bool
+BinarySearchTree<Key, Value, Compare>::cursor::operator!=(const cursor& rhs) const
+{
+    return !(*this == rhs); 
+}
+
+/**
+* Moves to the in-order successor: down to the leftmost node of the right
+* subtree, or else back up to the nearest ancestor we are left of, cutting
+* the path there in one step.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::cursor&
+BinarySearchTree<Key, Value, Compare>::cursor::operator++()
+{
+    if(path_.empty()) {
+      if(tree_ && tree_->root_) pushLeftmost(tree_->root_); 
+    }
+    else if(path_.back().node->getRight()) {
+      pushLeftmost(path_.back().node->getRight()); 
+    }
+    else {
+      path_.resize(path_.back().leftOf); 
+    }
+
+    if(!path_.empty()) prefetch(path_.back().node->getRight()); 
+    return *this; 
+}
+
+/**
+* The mirror image of operator++.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::cursor&
+BinarySearchTree<Key, Value, Compare>::cursor::operator--()
+{
+    if(path_.empty()) {
+      if(tree_ && tree_->root_) pushRightmost(tree_->root_); 
+    }
+    else if(path_.back().node->getLeft()) {
+      pushRightmost(path_.back().node->getLeft()); 
+    }
+    else {
+      path_.resize(path_.back().rightOf); 
+    }
+
+    if(!path_.empty()) prefetch(path_.back().node->getLeft()); 
+    return *this; 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::cursor::position() const
+{
+    return path_.empty() ? iterator() : tree_->makeIterator(path_.back().node); 
+}
+
+/**
+* Appends n, the left or right child of the node at the end of the path (or
+* the root if the path is empty), with its nearest left / right ancestors.
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::cursor::push(Node<Key, Value>* n, bool left)
+{
+    Frame f = { n, 0, 0 }; 
+    if(!path_.empty()) {
+      const Frame& parent = path_.back(); 
+      f.leftOf = left ? path_.size() : parent.leftOf; 
+      f.rightOf = left ? parent.rightOf : path_.size(); 
+    }
+    path_.push_back(f); 
+}
+
+// n is the root or the right child of the last node on the path
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::cursor::pushLeftmost(Node<Key, Value>* n)
+{
+    for(bool left = false; n; n = n->getLeft(), left = true) push(n, left); 
+}
+
+// n is the root or the left child of the last node on the path
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::cursor::pushRightmost(Node<Key, Value>* n)
+{
+    for(bool left = true; n; n = n->getRight(), left = false) push(n, left); 
+}
+
+// asks the cache for n while the caller works on the current item; a
+// no-op for NULL and for compilers without the builtin
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::cursor::prefetch(const Node<Key, Value>* n)
+{
+#if defined(__GNUC__)
+    if(n) __builtin_prefetch(n); 
+#else
+    (void)n; 
+#endif
+}
+
+/*
+-----------------------------------------------------------
+End implementations for the BinarySearchTree::cursor class.
+-----------------------------------------------------------
+*/
+
 /*
 -----------------------------------------------------
 Begin implementations for the BinarySearchTree class.
@@ -364,83 +996,518 @@ Begin implementations for the BinarySearchTree class.
 /**
 * Default constructor for a BinarySearchTree, which sets the root to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::BinarySearchTree() 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree() 
 {
     root_ = nullptr; 
+    leftmost_ = rightmost_ = nullptr; 
+    count_ = 0; 
+    autoRebalance_ = 0; 
+    insertsSinceRebalance_ = 0; 
 }
 
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::~BinarySearchTree()
+/**
+* Constructor for a BinarySearchTree ordered by the given comparator.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(const Compare& comp) :
+    root_(nullptr),
+    leftmost_(nullptr),
+    rightmost_(nullptr),
+    count_(0),
+    autoRebalance_(0),
+    insertsSinceRebalance_(0),
+    comp_(comp)
+{
+
+}
+
+/**
+* Copy constructor: a deep copy of other's shape and nodes (see cloneSubtree).
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(const BinarySearchTree& other) :
+    root_(cloneSubtree(other.root_, cloneThreads())),
+    count_(other.count_),
+    autoRebalance_(other.autoRebalance_),
+    insertsSinceRebalance_(0),
+    comp_(other.comp_)
+{
+    resetExtremes(); 
+}
+
+/**
+* Move constructor: takes other's nodes in O(1) and leaves other empty.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(BinarySearchTree&& other) :
+    root_(other.root_),
+    leftmost_(other.leftmost_),
+    rightmost_(other.rightmost_),
+    count_(other.count_),
+    autoRebalance_(other.autoRebalance_),
+    insertsSinceRebalance_(other.insertsSinceRebalance_),
+    comp_(std::move(other.comp_))
+{
+    other.root_ = other.leftmost_ = other.rightmost_ = nullptr; 
+    other.count_ = other.insertsSinceRebalance_ = 0; 
+}
+
+template<typename Key, typename Value, typename Compare>
+BinarySearchTree<Key, Value, Compare>::~BinarySearchTree()
 {
     clearHelper(root_); 
 
 }
 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>&
+BinarySearchTree<Key, Value, Compare>::operator=(const BinarySearchTree& other)
+{
+    if(this != &other) {
+      // copy first, so the tree is unchanged if copying throws
+      Node<Key, Value>* copy = cloneSubtree(other.root_, cloneThreads()); 
+      clearHelper(root_); 
+      root_ = copy; 
+      resetExtremes(); 
+      count_ = other.count_; 
+      autoRebalance_ = other.autoRebalance_; 
+      insertsSinceRebalance_ = 0; 
+      comp_ = other.comp_; 
+    }
+    return *this; 
+}
+
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>&
+BinarySearchTree<Key, Value, Compare>::operator=(BinarySearchTree&& other)
+{
+    if(this != &other) {
+      clearHelper(root_); 
+      root_ = other.root_; 
+      leftmost_ = other.leftmost_; 
+      rightmost_ = other.rightmost_; 
+      count_ = other.count_; 
+      autoRebalance_ = other.autoRebalance_; 
+      insertsSinceRebalance_ = other.insertsSinceRebalance_; 
+      other.root_ = other.leftmost_ = other.rightmost_ = nullptr; 
+      other.count_ = other.insertsSinceRebalance_ = 0; 
+      comp_ = std::move(other.comp_); 
+    }
+    return *this; 
+}
+
+/**
+* Exchanges the contents and comparators of two trees in O(1).
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::swap(BinarySearchTree& other)
+{
+    std::swap(root_, other.root_); 
+    std::swap(leftmost_, other.leftmost_); 
+    std::swap(rightmost_, other.rightmost_); 
+    std::swap(count_, other.count_); 
+    std::swap(autoRebalance_, other.autoRebalance_); 
+    std::swap(insertsSinceRebalance_, other.insertsSinceRebalance_); 
+    std::swap(comp_, other.comp_); 
+}
+
+/**
+ * Returns true if tree is empty
+*/
+template<class Key, class Value, class Compare>
+bool BinarySearchTree<Key, Value, Compare>::empty() const
+{
+    return root_ == NULL;
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::print() const
+{
+    printRoot(root_);
+    std::cout << "\n";
+}
+
+/**
+* Returns an iterator to the "smallest" item in the tree, which is cached
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::begin()
+{
+    BinarySearchTree<Key, Value, Compare>::iterator begin(getSmallestNode(), this);
+    return begin;
+}
+
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::end()
+{
+    BinarySearchTree<Key, Value, Compare>::iterator end(NULL, this);
+    return end;
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::begin() const
+{
+    return makeConstIterator(getSmallestNode()); 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::end() const
+{
+    return makeConstIterator(NULL); 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::cbegin() const
+{
+    return begin(); 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::cend() const
+{
+    return end(); 
+}
+
+/**
+* Reverse iterators start at end(): the reverse_iterator adaptor reads
+* the item before its base, so rbegin() is the largest item.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::reverse_iterator
+BinarySearchTree<Key, Value, Compare>::rbegin()
+{
+    return reverse_iterator(end()); 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::reverse_iterator
+BinarySearchTree<Key, Value, Compare>::rend()
+{
+    return reverse_iterator(begin()); 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_reverse_iterator
+BinarySearchTree<Key, Value, Compare>::rbegin() const
+{
+    return const_reverse_iterator(end()); 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_reverse_iterator
+BinarySearchTree<Key, Value, Compare>::rend() const
+{
+    return const_reverse_iterator(begin()); 
+}
+
+/**
+* Cursors at the smallest item (the end if empty) and at the end.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::cursor
+BinarySearchTree<Key, Value, Compare>::cursorBegin() const
+{
+    cursor c(this); 
+    return ++c; 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::cursor
+BinarySearchTree<Key, Value, Compare>::cursorEnd() const
+{
+    return cursor(this); 
+}
+
+/**
+* A cursor at the first item whose key is not less than key, like
+* lower_bound.  The descent records its path, and the path to the answer is
+* the prefix ending at the last node where it went left.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::cursor
+BinarySearchTree<Key, Value, Compare>::cursorLowerBound(const Key& key) const
+{
+    cursor c(this); 
+    size_t found = 0; 
+    bool left = false; 
+    KeyProbe<Key, Compare, Key> probe(comp_, key); 
+    for(Node<Key, Value>* current = root_; current; ) {
+      c.push(current, left); 
+      left = probe.compare(current) <= 0; 
+      if(left) {
+        found = c.path_.size(); 
+        current = current->getLeft(); 
+      }
+      else
+        current = current->getRight(); 
+    }
+    c.path_.resize(found); 
+    if(found) cursor::prefetch(c.path_.back().node->getRight()); 
+    return c; 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::makeIterator(Node<Key, Value>* n) const
+{
+    return BinarySearchTree<Key, Value, Compare>::iterator(n, this);
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::makeConstIterator(Node<Key, Value>* n) const
+{
+    return BinarySearchTree<Key, Value, Compare>::const_iterator(n, this);
+}
+
+/**
+* Returns an iterator to the item with the given key, k
+* or the end iterator if k does not exist in the tree
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(const Key & k)
+{
+    Node<Key, Value> *curr = internalFind(k);
+    BinarySearchTree<Key, Value, Compare>::iterator it(curr, this);
+    return it;
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::find(const Key & k) const
+{
+    return makeConstIterator(internalFind(k)); 
+}
+
+/**
+* Heterogeneous find, only available with a transparent comparator:
+* k is compared against the stored keys as is, without building a Key.
+*/
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(const K & k)
+{
+    return makeIterator(internalFind(k));
+}
+
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::find(const K & k) const
+{
+    return makeConstIterator(internalFind(k));
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than key,
+* or end() if there is none.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(const Key& key)
+{
+    return makeIterator(lowerBoundNode(key)); 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(const Key& key) const
+{
+    return makeConstIterator(lowerBoundNode(key)); 
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::lowerBoundNode(const Key& key) const
+{
+    Node<Key, Value>* current = root_; 
+    Node<Key, Value>* result = nullptr; 
+    KeyProbe<Key, Compare, Key> probe(comp_, key); 
+    while(current) {
+      // current is a candidate whenever key <= current's key
+      if(probe.compare(current) <= 0) {
+        result = current; 
+        current = current->getLeft(); 
+      }
+      else
+        current = current->getRight(); 
+    }
+    return result; 
+}
+
+/**
+* Returns an iterator to the first item whose key is greater than key,
+* or end() if there is none.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::upper_bound(const Key& key)
+{
+    return makeIterator(upperBoundNode(key)); 
+}
+
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::upper_bound(const Key& key) const
+{
+    return makeConstIterator(upperBoundNode(key)); 
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::upperBoundNode(const Key& key) const
+{
+    Node<Key, Value>* current = root_; 
+    Node<Key, Value>* result = nullptr; 
+    KeyProbe<Key, Compare, Key> probe(comp_, key); 
+    while(current) {
+      if(probe.compare(current) < 0) {
+        result = current; 
+        current = current->getLeft(); 
+      }
+      else
+        current = current->getRight(); 
+    }
+    return result; 
+}
+
+/**
+* Returns the range of items whose key is equivalent to key.
+*/
+template<class Key, class Value, class Compare>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::iterator,
+          typename BinarySearchTree<Key, Value, Compare>::iterator>
+BinarySearchTree<Key, Value, Compare>::equal_range(const Key& key)
+{
+    return std::make_pair(lower_bound(key), upper_bound(key)); 
+}
+
+template<class Key, class Value, class Compare>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::const_iterator,
+          typename BinarySearchTree<Key, Value, Compare>::const_iterator>
+BinarySearchTree<Key, Value, Compare>::equal_range(const Key& key) const
+{
+    return std::make_pair(lower_bound(key), upper_bound(key)); 
+}
+
 /**
- * Returns true if tree is empty
+* Returns the number of items with the given key (0 or 1 unless the tree
+* keeps duplicates).
 */
-template<class Key, class Value>
-bool BinarySearchTree<Key, Value>::empty() const
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::count(const Key& key) const
 {
-    return root_ == NULL;
+    std::pair<const_iterator, const_iterator> range = equal_range(key); 
+    size_t n = 0; 
+    for(const_iterator it = range.first; it != range.second; ++it) n++; 
+    return n; 
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::print() const
+template<class Key, class Value, class Compare>
+template<typename Callback>
+size_t BinarySearchTree<Key, Value, Compare>::scan(const Key& lo, const Key& hi, Callback callback) const
 {
-    printRoot(root_);
-    std::cout << "\n";
+    return scanRange(lo, hi, callback); 
 }
 
-/**
-* Returns an iterator to the "smallest" item in the tree
-*/
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::begin() const
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::scan_into(const Key& lo, const Key& hi,
+    std::pair<Key, Value>* buffer, size_t capacity) const
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
-    return begin;
+    if(!capacity) return 0; 
+    size_t n = 0; 
+    auto copy = [&](const std::pair<const Key, Value>& item) {
+      buffer[n++] = item; 
+      return n < capacity; 
+    };
+    scanRange(lo, hi, copy); 
+    return n; 
 }
 
 /**
-* Returns an iterator whose value means INVALID
+* Returns the number of items copied in all, including the items of the
+* block whose flush stopped the scan.
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::end() const
+template<class Key, class Value, class Compare>
+template<typename Flush>
+size_t BinarySearchTree<Key, Value, Compare>::scan_into(const Key& lo, const Key& hi,
+    std::pair<Key, Value>* buffer, size_t capacity, Flush flush) const
 {
-    BinarySearchTree<Key, Value>::iterator end(NULL);
-    return end;
+    if(!capacity) return 0; 
+    size_t n = 0; 
+    bool stopped = false; 
+    auto copy = [&](const std::pair<const Key, Value>& item) {
+      buffer[n++] = item; 
+      if(n < capacity) return true; 
+      n = 0; 
+      stopped = !flush(buffer, capacity); 
+      return !stopped; 
+    };
+    size_t total = scanRange(lo, hi, copy); 
+    if(n && !stopped) flush(buffer, n); 
+    return total; 
 }
 
 /**
-* Returns an iterator to the item with the given key, k
-* or the end iterator if k does not exist in the tree
+* The traversal behind the scans.  The descent keeps only the nodes whose
+* key is at least lo, which is the path to lower_bound(lo) plus the nodes
+* it still has to return to; after that each item costs one comparison
+* against hi and the pushes for its right subtree's left spine.
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::find(const Key & k) const
+template<class Key, class Value, class Compare>
+template<typename Visit>
+size_t BinarySearchTree<Key, Value, Compare>::scanRange(const Key& lo, const Key& hi, Visit& visit) const
 {
-    Node<Key, Value> *curr = internalFind(k);
-    BinarySearchTree<Key, Value>::iterator it(curr);
-    return it;
+    std::vector<Node<Key, Value>*> stack; 
+    KeyProbe<Key, Compare, Key> loProbe(comp_, lo); 
+    KeyProbe<Key, Compare, Key> hiProbe(comp_, hi); 
+
+    for(Node<Key, Value>* current = root_; current; ) {
+      if(loProbe.compare(current) <= 0) {
+        stack.push_back(current); 
+        current = current->getLeft(); 
+      }
+      else
+        current = current->getRight(); 
+    }
+
+    size_t visited = 0; 
+    while(!stack.empty()) {
+      Node<Key, Value>* n = stack.back(); 
+      stack.pop_back(); 
+      if(hiProbe.compare(n) <= 0) break; 
+
+      visited++; 
+      const Node<Key, Value>* item = n; 
+      if(!visit(item->getItem())) break; 
+      for(Node<Key, Value>* current = n->getRight(); current; current = current->getLeft()) stack.push_back(current); 
+    }
+    return visited; 
 }
 
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
  */
-template<class Key, class Value>
-Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
+template<class Key, class Value, class Compare>
+Value& BinarySearchTree<Key, Value, Compare>::operator[](const Key& key)
 {
     Node<Key, Value> *curr = internalFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
-template<class Key, class Value>
-Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
+template<class Key, class Value, class Compare>
+Value const & BinarySearchTree<Key, Value, Compare>::operator[](const Key& key) const
 {
     Node<Key, Value> *curr = internalFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
@@ -453,21 +1520,24 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 * Recall: If key is already in the tree, you should 
 * overwrite the current value with the updated value.
 */
-template<class Key, class Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::insert(const std::pair<const Key, Value> &keyValuePair)
 { 
 
     Node<Key, Value>* current = root_; 
     Node<Key, Value>* parent = nullptr; 
-
-    while(current && (current->getKey() != keyValuePair.first)) {
-      if(keyValuePair.first < current->getKey()) {
-        parent = current; 
+    int c = 0; 
+    size_t depth = 0; 
+    KeyProbe<Key, Compare, Key> probe(comp_, keyValuePair.first); 
+
+    // one comparison per level; c remembers the last one
+    while(current && (c = probe.compare(current)) != 0) {
+      parent = current; 
+      depth++; 
+      if(c < 0)
         current = current->getLeft(); 
-      } else if(keyValuePair.first > current->getKey()) {
-        parent = current; 
+      else
         current = current->getRight(); 
-      }
     }
 
     // check if current is null, which means new node
@@ -476,14 +1546,16 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
       // check if parent is null, if it is then update root
       if(!parent) root_ = current; 
       // check if its a right or left link with parent
-      else if(current->getKey() < parent->getKey())
+      else if(c < 0)
         parent->setLeft(current); 
       else  
         parent->setRight(current); 
+      leafLinked(current); 
+      leafInserted(depth); 
     }
 
     // otherwise current should have same key as keyValuePair
-    else if(current->getKey() == keyValuePair.first)
+    else
       current->setValue(keyValuePair.second); 
 
 
@@ -491,29 +1563,26 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 }
 
 
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 Node<Key, Value>* 
-BinarySearchTree<Key, Value>::insertHelper(Node<Key, Value>* current, const std::pair<const Key, Value>& keyValuePair) {
+BinarySearchTree<Key, Value, Compare>::insertHelper(Node<Key, Value>* current, const std::pair<const Key, Value>& keyValuePair) {
   
   // CASE 1: current node is null, so return new node
   if(!current) return new Node<Key, Value>(keyValuePair.first, keyValuePair.second, nullptr); 
 
   // std::cout << "Current start " << current->getKey() << " "<< current->getValue() << std::endl;
 
+  int c = compareKeys(keyValuePair.first, current->getKey()); 
+
   // CASE 2: new key is less than current node, recurse to the left
-  if(keyValuePair.first < current->getKey()) {
+  if(c < 0) {
     current->setLeft(insertHelper(current->getLeft(), keyValuePair)); 
     if(current->getLeft())
       current->getLeft()->setParent(current); 
   }
 
   // CASE 3: new key is greater than current node, recurse to the right
-  else if(keyValuePair.first > current->getKey()) {
-
-    Key currentKey = current->getKey(); 
-    Node<Key, Value>* currentParent = current->getParent(); 
-    Node<Key, Value>* currentLeft = current->getLeft(); 
-    Node<Key, Value>* currentRight = current->getRight(); 
+  else if(c > 0) {
     current->setRight(insertHelper(current->getRight(), keyValuePair));
     if(current->getRight())
       current->getRight()->setParent(current); 
@@ -537,23 +1606,30 @@ BinarySearchTree<Key, Value>::insertHelper(Node<Key, Value>* current, const std:
 * Recall: The writeup specifies that if a node has 2 children you
 * should swap with the predecessor and then remove.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::remove(const Key& key)
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::remove(const Key& key)
 {
-    // TODO
 
-    Node<Key,Value>* current = root_; 
-    while(current && current->getKey() != key) {
-      if(key < current->getKey())
-        current = current->getLeft(); 
-      else if(key > current->getKey())
-        current = current->getRight();   
-    }
+    Node<Key,Value>* current = internalFind(key); 
 
     // CASE 1: There is no node with the desired key to be removed
     if(!current) return;
 
-      // removes current node
+    // free memory of current node
+    delete unlinkNode(current); 
+    
+}
+
+/**
+* Unlinks a node from the tree without freeing it and returns it.
+* Recall: if the node has 2 children it is first swapped with its predecessor,
+* so afterwards it has at most one child, which takes its place.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::unlinkNode(Node<Key, Value>* current)
+{
+    nodeLeaving(current); 
+
     // CASE 1: 2 Children (Swaps current with predecessor)
     if(current->getLeft() && current->getRight()) {
       // std::cout << "value of root " << root_->getValue() << std::endl; 
@@ -625,22 +1701,286 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 
       
     }
-    // free memory of current node
-    delete current; 
-    
+    return current; 
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::removeHelper(Node<Key, Value>* current, const Key& key) {
+/**
+* Walks down towards key.  Returns its node if present; otherwise returns NULL
+* and leaves parent at the node a new leaf would hang from (NULL for an empty
+* tree), with c < 0 if it goes on the left.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::descend(const Key& key, Node<Key, Value>*& parent, int& c) const
+{
+    Node<Key, Value>* current = root_; 
+    parent = nullptr; 
+    c = 0; 
+    KeyProbe<Key, Compare, Key> probe(comp_, key); 
+    while(current && (c = probe.compare(current)) != 0) {
+      parent = current; 
+      current = (c < 0) ? current->getLeft() : current->getRight(); 
+    }
+    return current; 
+}
+
+/**
+* Takes n out of the tree without freeing it, restoring whatever invariants
+* the tree keeps.  Derived trees override this together with attachNode.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::detachNode(Node<Key, Value>* n)
+{
+    return unlinkNode(n); 
+}
+
+/**
+* Links the detached node n in by its key and returns the node now holding
+* that key.  Recall: if the key is already in the tree, its value is
+* overwritten; n is then freed.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::attachNode(Node<Key, Value>* n)
+{
+    Node<Key, Value>* parent; 
+    int c; 
+    Node<Key, Value>* current = descend(n->getKey(), parent, c); 
+
+    // CASE 1: key is already in the tree, just update the value
+    if(current) {
+      current->setValue(n->getValue()); 
+      delete n; 
+      return current; 
+    }
+
+    // CASE 2: link n in as a leaf
+    n->setParent(parent); 
+    if(!parent) root_ = n; 
+    else if(c < 0) parent->setLeft(n); 
+    else parent->setRight(n); 
+    leafLinked(n); 
+    return n; 
+}
+
+/**
+* True if n has the node type this tree allocates, so that attachNode may
+* link it in.  Any Node works for the unbalanced tree.
+*/
+template<typename Key, typename Value, typename Compare>
+bool BinarySearchTree<Key, Value, Compare>::isCompatibleNode(const Node<Key, Value>*) const
+{
+    return true; 
+}
+
+/**
+* Removes the item with the given key and returns it in a node handle, or
+* returns an empty handle if the key is not in the tree.
+*/
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::node_type
+BinarySearchTree<Key, Value, Compare>::extract(const Key& key)
+{
+    Node<Key, Value>* current = internalFind(key); 
+    return extract(makeIterator(current)); 
+}
+
+/**
+* Removes the item at pos (which may be end()) and returns it in a node handle.
+*/
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::node_type
+BinarySearchTree<Key, Value, Compare>::extract(iterator pos)
+{
+    Node<Key, Value>* current = pos.current_; 
+    if(!current) return node_type(); 
+
+    current = detachNode(current); 
+    current->setParent(nullptr); 
+    current->setLeft(nullptr); 
+    current->setRight(nullptr); 
+    return node_type(current); 
+}
+
+/**
+* Links the handle's node into the tree without allocating and returns an
+* iterator to the item with its key.  The handle is left empty.
+* Throws std::invalid_argument if the node came from a different kind of tree.
+*/
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::insert(node_type&& nh)
+{
+    if(nh.empty()) return end(); 
+    if(!isCompatibleNode(nh.node_)) throw std::invalid_argument("Incompatible node"); 
+
+    Node<Key, Value>* current = nh.node_; 
+    nh.node_ = nullptr; 
+    return makeIterator(attachNode(current)); 
+}
+
+/**
+* Removes the item at pos without searching for its key.  Returns an
+* iterator to the next item.
+* precondition: pos is a valid iterator into this tree (not end())
+*/
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::erase(iterator pos)
+{
+    Node<Key, Value>* current = pos.current_; 
+    // nodes are relinked, never copied, so the successor stays valid
+    Node<Key, Value>* next = successor(current); 
+    delete detachNode(current); 
+    return makeIterator(next); 
+}
+
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::min()
+{
+    return makeIterator(leftmost_); 
+}
+
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::max()
+{
+    return makeIterator(rightmost_); 
+}
+
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::min() const
+{
+    return makeConstIterator(leftmost_); 
+}
+
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::max() const
+{
+    return makeConstIterator(rightmost_); 
+}
+
+/**
+* Removes the smallest item, if any.  The node is already known, so only the
+* unlink and its rebalancing remain.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::pop_min()
+{
+    if(leftmost_) delete detachNode(leftmost_); 
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::pop_max()
+{
+    if(rightmost_) delete detachNode(rightmost_); 
+}
+
+/**
+* Removes every item in [first, last) and returns last.
+* precondition: first is not after last
+*/
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::erase(iterator first, iterator last)
+{
+    if(first != last) eraseRange(first.current_, last.current_); 
+    return last; 
+}
+
+/**
+* Range removal by tree surgery: split the tree around last, split the part
+* before it around first, free everything in between, then join the outer
+* parts back together around last.  That walks two root-to-node paths plus
+* the k freed nodes, so it takes O(h + k) instead of k removals.  Trees with
+* invariants the split/join hooks do not keep override this.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::eraseRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    Node<Key, Value>* after = nullptr; 
+    if(last) {
+      Node<Key, Value>* prefix; 
+      splitAround(last, prefix, after); 
+    }
+
+    // first is in the part before last, whose root splitAround left
+    // parentless, so it can be split on its own
+    Node<Key, Value>* before; 
+    Node<Key, Value>* middle; 
+    splitAround(first, before, middle); 
+    delete first; 
+    count_ -= 1 + clearHelper(middle); 
+
+    root_ = last ? joinAround(before, last, after) : before; 
+    resetExtremes(); 
+}
+
+/**
+* Cuts the tree holding x into the items before x (lo) and after x (hi),
+* walking up from x; x itself ends up in neither.  The plain tree relinks
+* each ancestor onto the side it belongs to, so this is O(depth of x).
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::splitAround(Node<Key, Value>* x, Node<Key, Value>*& lo, Node<Key, Value>*& hi)
+{
+    lo = x->getLeft(); 
+    hi = x->getRight(); 
+    if(lo) lo->setParent(nullptr); 
+    if(hi) hi->setParent(nullptr); 
+
+    Node<Key, Value>* child = x; 
+    Node<Key, Value>* a = x->getParent(); 
+    while(a) {
+      Node<Key, Value>* next = a->getParent(); 
+      // CASE 1: we came up from the left, so a and its right subtree follow x
+      if(a->getLeft() == child) {
+        a->setLeft(hi); 
+        if(hi) hi->setParent(a); 
+        hi = a; 
+      }
+      // CASE 2: we came up from the right, so a and its left subtree precede x
+      else {
+        a->setRight(lo); 
+        if(lo) lo->setParent(a); 
+        lo = a; 
+      }
+      a->setParent(nullptr); 
+      child = a; 
+      a = next; 
+    }
+}
+
+/**
+* Returns a tree of lo, then k, then hi.  Every key in lo must order before
+* k and every key in hi after it.  The plain tree just makes k the root.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::joinAround(Node<Key, Value>* lo, Node<Key, Value>* k, Node<Key, Value>* hi)
+{
+    k->setParent(nullptr); 
+    k->setLeft(lo); 
+    k->setRight(hi); 
+    if(lo) lo->setParent(k); 
+    if(hi) hi->setParent(k); 
+    return k; 
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::removeHelper(Node<Key, Value>* current, const Key& key) {
   
   if(!current) return;
 
+  int c = compareKeys(key, current->getKey()); 
+
   // checks if key is less than current node and recurses left
-  if(key < current->getKey())
+  if(c < 0)
     return removeHelper(current->getLeft(), key); 
 
   // checks if key is greater than current node and recurses right
-  if(key > current->getKey())
+  if(c > 0)
     return removeHelper(current->getRight(), key); 
 
 
@@ -753,9 +2093,9 @@ void BinarySearchTree<Key, Value>::removeHelper(Node<Key, Value>* current, const
 }
 
 
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current) 
+BinarySearchTree<Key, Value, Compare>::predecessor(Node<Key, Value>* current) 
 {
     // if node has a left subtree, predecessor is max node of right subtree
     // otherwise, predecessor is the first parent that comes up from a right link
@@ -781,9 +2121,9 @@ BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
 }
 
 
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
+BinarySearchTree<Key, Value, Compare>::successor(Node<Key, Value>* current)
 {
     // if node has a right subtree, predecessor is min node of left subtree
     // otherwise, successor is the first parent that comes up from a left link
@@ -805,9 +2145,9 @@ BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
 
 
 // returns pointer to smallest node in a subtree
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::getSmallestNodeOfTree(Node<Key, Value>* current)
+BinarySearchTree<Key, Value, Compare>::getSmallestNodeOfTree(Node<Key, Value>* current)
 {
 
   if(!current || !current->getLeft()) return current; 
@@ -815,9 +2155,9 @@ BinarySearchTree<Key, Value>::getSmallestNodeOfTree(Node<Key, Value>* current)
 }
 
 // returns pointer to largest node in a subtree
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::getLargestNodeOfTree(Node<Key, Value>* current)
+BinarySearchTree<Key, Value, Compare>::getLargestNodeOfTree(Node<Key, Value>* current)
 {
   if((!current) || (!current->getRight())) return current; 
   else return getLargestNodeOfTree(current->getRight()); 
@@ -827,32 +2167,236 @@ BinarySearchTree<Key, Value>::getLargestNodeOfTree(Node<Key, Value>* current)
 * A method to remove all contents of the tree and
 * reset the values in the tree for use again.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clear()
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::clear()
 { 
     clearHelper(root_); 
     root_ = nullptr; 
+    leftmost_ = rightmost_ = nullptr; 
+    count_ = 0; 
+    cleared(); 
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clearHelper(Node<Key, Value>* current)
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::cleared()
+{
+
+}
+
+/**
+* Returns a copy of the subtree rooted at src with the same shape.  Each node
+* copies itself through Node::clone, which carries balances, colors and the
+* like, so no keys are compared.  While threads > 1 and both children of src
+* are large, the left subtree is copied on a new thread with half of them;
+* below that the copy is an iterative pre-order walk, so degenerate trees
+* cannot overflow the stack.  If any copy throws, everything copied so far
+* is freed and the exception is passed on.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::cloneSubtree(const Node<Key, Value>* src, unsigned threads)
+{
+    if(!src) return nullptr; 
+
+    if(threads > 1 && isLargeSubtree(src->getLeft()) && isLargeSubtree(src->getRight())) {
+      Node<Key, Value>* copy = cloneNode(src, nullptr); 
+      Node<Key, Value>* left = nullptr; 
+      Node<Key, Value>* right = nullptr; 
+      // an exception must not escape the worker (that would terminate), so
+      // it is carried back and rethrown here once both halves are settled
+      std::exception_ptr leftError; 
+      auto cloneLeft = [&]() {
+        try {
+          left = cloneSubtree(src->getLeft(), threads / 2); 
+        }
+        catch(...) {
+          leftError = std::current_exception(); 
+        }
+      }; 
+      std::thread worker; 
+      try {
+        worker = std::thread(cloneLeft); 
+      }
+      catch(const std::system_error&) {
+        // no thread to be had, so copy the left side here instead
+        cloneLeft(); 
+      }
+      try {
+        right = cloneSubtree(src->getRight(), threads - threads / 2); 
+      }
+      catch(...) {
+        if(worker.joinable()) worker.join(); 
+        clearHelper(left); 
+        delete copy; 
+        throw; 
+      }
+      if(worker.joinable()) worker.join(); 
+      if(leftError) {
+        clearHelper(right); 
+        delete copy; 
+        std::rethrow_exception(leftError); 
+      }
+      copy->setLeft(left); 
+      left->setParent(copy); 
+      copy->setRight(right); 
+      right->setParent(copy); 
+      return copy; 
+    }
+
+    Node<Key, Value>* top = cloneNode(src, nullptr); 
+    const Node<Key, Value>* s = src; 
+    Node<Key, Value>* d = top; 
+    // d is the copy of s; a child of d that is still NULL has not been copied yet
+    // a node is linked in only once it is fully copied, so if a copy throws
+    // the part built so far is a well-formed tree and can be freed whole
+    try {
+      while(true) {
+        // CASE 1: copy the left child and descend into it
+        if(s->getLeft() && !d->getLeft()) {
+          s = s->getLeft(); 
+          d->setLeft(cloneNode(s, d)); 
+          d = d->getLeft(); 
+        }
+        // CASE 2: copy the right child and descend into it
+        else if(s->getRight() && !d->getRight()) {
+          s = s->getRight(); 
+          d->setRight(cloneNode(s, d)); 
+          d = d->getRight(); 
+        }
+        // CASE 3: both children are done, so go back up
+        else if(s == src) {
+          break; 
+        }
+        else {
+          s = s->getParent(); 
+          d = d->getParent(); 
+        }
+      }
+    }
+    catch(...) {
+      clearHelper(top); 
+      throw; 
+    }
+    return top; 
+}
+
+// a copy of src attached to parent, with no children yet
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::cloneNode(const Node<Key, Value>* src, Node<Key, Value>* parent)
+{
+    Node<Key, Value>* copy = src->clone(); 
+    copy->setParent(parent); 
+    copy->setLeft(nullptr); 
+    copy->setRight(nullptr); 
+    return copy; 
+}
+
+// O(log n) size estimate: both outer spines reach BST_PARALLEL_CLONE_DEPTH
+template<typename Key, typename Value, typename Compare>
+bool BinarySearchTree<Key, Value, Compare>::isLargeSubtree(const Node<Key, Value>* n)
+{
+    const Node<Key, Value>* l = n; 
+    const Node<Key, Value>* r = n; 
+    for(int i = 0; i < BST_PARALLEL_CLONE_DEPTH; i++) {
+      if(!l || !r) return false; 
+      l = l->getLeft(); 
+      r = r->getRight(); 
+    }
+    return true; 
+}
+
+template<typename Key, typename Value, typename Compare>
+unsigned BinarySearchTree<Key, Value, Compare>::cloneThreads()
+{
+    unsigned n = std::thread::hardware_concurrency(); 
+    return n ? n : 1; 
+}
+
+// Frees a subtree without recursion, so degenerate (list-shaped) trees
+// cannot overflow the stack: left children are rotated up until the
+// current node has none, then it is freed and we move right.
+template<typename Key, typename Value, typename Compare>
+size_t BinarySearchTree<Key, Value, Compare>::clearHelper(Node<Key, Value>* current)
 {
-    if(!current) return; 
-    clearHelper(current->getLeft()); 
-    clearHelper(current->getRight()); 
-    delete current; 
+    size_t freed = 0; 
+    while(current) {
+      Node<Key, Value>* left = current->getLeft(); 
+      if(left) {
+        current->setLeft(left->getRight()); 
+        left->setRight(current); 
+        current = left; 
+      }
+      else {
+        Node<Key, Value>* right = current->getRight(); 
+        delete current; 
+        current = right; 
+        freed++; 
+      }
+    }
+    return freed; 
 }
 
 
 /**
 * A helper function to find the smallest node in the tree.
 */
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::getSmallestNode() const
+{
+    return leftmost_; 
+}
+
+/**
+* A helper function to find the largest node in the tree.
+*/
+template<typename Key, typename Value, typename Compare>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::getSmallestNode() const
+BinarySearchTree<Key, Value, Compare>::getLargestNode() const
 {
-    // std::cout << "getting smallest node" << std::endl; 
-    return getSmallestNodeOfTree(root_); 
+    return rightmost_; 
+}
+
+/**
+* Updates the cached extremes after the leaf n was linked in.  Call it before
+* any rebalancing: a new leaf is a new extreme exactly when it hangs on the
+* outer side of the old one.  Rotations and rebuilds move nodes but never
+* change which node is smallest or largest.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::leafLinked(Node<Key, Value>* n)
+{
+    Node<Key, Value>* parent = n->getParent(); 
+    if(!parent) {
+      leftmost_ = rightmost_ = n; 
+      count_++; 
+      return; 
+    }
+    count_++; 
+    if(parent == leftmost_ && parent->getLeft() == n) leftmost_ = n; 
+    if(parent == rightmost_ && parent->getRight() == n) rightmost_ = n; 
+}
+
+/**
+* Updates the cached extremes before n is unlinked, while the tree is still
+* intact.  The smallest node has no left child, so its successor is close by
+* (and likewise for the largest).
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::nodeLeaving(Node<Key, Value>* n)
+{
+    count_--; 
+    if(n == leftmost_) leftmost_ = successor(n); 
+    if(n == rightmost_) rightmost_ = predecessor(n); 
+}
+
+// recomputes the cached extremes from the root after bulk changes
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::resetExtremes()
+{
+    leftmost_ = getSmallestNodeOfTree(root_); 
+    rightmost_ = getLargestNodeOfTree(root_); 
 }
 
 /**
@@ -860,14 +2404,16 @@ BinarySearchTree<Key, Value>::getSmallestNode() const
 * return a pointer to it or NULL if no item with that key
 * exists
 */
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::internalFind(const K& key) const
 {
-    // TODO
     // std::cout << "finding key " << key << std::endl; 
     Node<Key, Value>* current = root_; 
-    while(current && current->getKey() != key) {
-      if(key < current->getKey())
+    KeyProbe<Key, Compare, K> probe(comp_, key); 
+    int c; 
+    while(current && (c = probe.compare(current)) != 0) {
+      if(c < 0)
         current = current->getLeft(); 
       else
         current = current->getRight(); 
@@ -875,21 +2421,38 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) con
     return current; 
 }
 
+/**
+* Compares two keys with the tree's comparator (see compareWith).
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename A, typename B>
+int BinarySearchTree<Key, Value, Compare>::compareKeys(const A& a, const B& b) const
+{
+    return compareWith(comp_, a, b); 
+}
+/**
+* Returns the number of items, which the tree keeps count of.
+*/
+template<typename Key, typename Value, typename Compare>
+size_t BinarySearchTree<Key, Value, Compare>::size() const
+{
+    return count_; 
+}
+
 /**
  * Return true iff the BST is balanced.
  */
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalanced() const
+template<typename Key, typename Value, typename Compare>
+bool BinarySearchTree<Key, Value, Compare>::isBalanced() const
 {
-    // TODO
     // std::cout << "findng balance " << std::endl;
     return isBalancedHelper(root_) >= 0; 
 }
 
 // returns height of the tree if the subtree is balanced
 // returns -1 if the tree is not balanced
-template<typename Key, typename Value>
-int BinarySearchTree<Key, Value>::isBalancedHelper(Node<Key, Value>* current) 
+template<typename Key, typename Value, typename Compare>
+int BinarySearchTree<Key, Value, Compare>::isBalancedHelper(Node<Key, Value>* current) 
 {
   if(!current) return 0; 
 
@@ -905,9 +2468,94 @@ int BinarySearchTree<Key, Value>::isBalancedHelper(Node<Key, Value>* current)
   return 1 + std::max(leftBalance, rightBalance); 
 }
 
+/**
+* Day-Stout-Warren: rotate the tree into a right-leaning vine, then fold the
+* vine in halves with left rotations.  The first pass moves the n - m nodes
+* that do not fit a perfect tree of m = 2^k - 1 nodes onto the bottom level,
+* so every level but the last ends up full.  Both passes are O(n) rotations
+* and need no stack, like clearHelper.  Derived trees override this to
+* refresh their per-node data afterwards.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::rebalance()
+{
+    size_t count = treeToVine(); 
+    compressVine(count); 
+    insertsSinceRebalance_ = 0; 
+}
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
+// right rotations until no node has a left child; returns the node count
+template<typename Key, typename Value, typename Compare>
+size_t BinarySearchTree<Key, Value, Compare>::treeToVine()
+{
+    size_t count = 0; 
+    Node<Key, Value>* current = root_; 
+    while(current) {
+      if(current->getLeft()) {
+        BinarySearchTree<Key, Value, Compare>::rotateRight(current); 
+        current = current->getParent(); 
+      }
+      else {
+        count++; 
+        current = current->getRight(); 
+      }
+    }
+    return count; 
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::compressVine(size_t count)
+{
+    size_t full = 1; 
+    while(full <= count + 1) full *= 2; 
+    full = full / 2 - 1; 
+
+    // each pass rotates left at every other vine node, starting at the root
+    size_t steps = count - full; 
+    for(;;) {
+      Node<Key, Value>* current = root_; 
+      for(size_t i = 0; i < steps; i++) {
+        Node<Key, Value>* child = current->getRight(); 
+        BinarySearchTree<Key, Value, Compare>::rotateLeft(current); 
+        current = child->getRight(); 
+      }
+      if(full <= 1) break; 
+      full /= 2; 
+      steps = full; 
+    }
+}
+
+template<typename Key, typename Value, typename Compare>
+const Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::rootNode() const
+{
+    return root_; 
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::setAutoRebalance(double factor)
+{
+    autoRebalance_ = factor; 
+}
+
+/**
+* Called by the unbalanced trees after linking a leaf at the given depth.
+* A rebuild costs O(n), so it also waits for n / (factor * log2(n)) inserts
+* since the last one: that keeps the amortized cost per insert within the
+* O(factor * log n) depth the trigger enforces.  Between rebuilds a sorted
+* run can still grow a path longer than the limit.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::leafInserted(size_t depth)
+{
+    insertsSinceRebalance_++; 
+    if(autoRebalance_ <= 0 || count_ < 4) return; 
+    double limit = autoRebalance_ * std::log2((double)count_); 
+    if(depth > limit && insertsSinceRebalance_ * limit >= count_) rebalance(); 
+}
+
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
 {
 
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
@@ -994,6 +2642,56 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
 
 }
 
+// Lifts n's left child into n's place; n becomes its right child.
+// precondition: n has a left child
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::rotateRight(Node<Key, Value>* n)
+{
+  Node<Key, Value>* g = n->getParent();   // grandparent
+  Node<Key, Value>* a = n->getLeft();     // replacing n's node
+  Node<Key, Value>* m = a->getRight();    // moving node
+
+  a->setParent(g); 
+  // If there is no parent, root must be updated
+  if(!g) 
+    root_ = a; 
+  else if(g->getLeft() == n)
+    g->setLeft(a); 
+  else if(g->getRight() == n)
+    g->setRight(a); 
+
+  n->setParent(a); 
+  a->setRight(n); 
+
+  n->setLeft(m); 
+  if(m) m->setParent(n); 
+}
+
+// Lifts n's right child into n's place; n becomes its left child.
+// precondition: n has a right child
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::rotateLeft(Node<Key, Value>* n)
+{
+  Node<Key, Value>* g = n->getParent();   // grandparent
+  Node<Key, Value>* a = n->getRight();    // replacing n's node
+  Node<Key, Value>* m = a->getLeft();     // moving node
+
+  a->setParent(g); 
+  // if node has no parent, root must be updated
+  if(!g)
+    root_ = a; 
+  else if(g->getLeft() == n)
+    g->setLeft(a); 
+  else if(g->getRight() == n)
+    g->setRight(a); 
+
+  n->setParent(a); 
+  a->setLeft(n); 
+
+  n->setRight(m); 
+  if(m) m->setParent(n); 
+}
+
 /**
  * Lastly, we are providing you with a print function,
    BinarySearchTree::printRoot().
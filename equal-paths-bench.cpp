@@ -0,0 +1,178 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+#include <ctime>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "equal-paths.h"
+
+using namespace std;
+
+/*
+  Benchmark for equalPaths over generated trees.
+
+  Shapes:
+    balanced  perfect tree (n rounded down to 2^k - 1), every leaf at one
+              depth, so the whole tree is walked and the answer is true
+    skewed    a left chain, one leaf at depth n, walked completely
+    random    random binary search tree shape (left size uniform), which
+              almost always has unequal leaves and exits early
+
+  Nodes live in one array, so 100M nodes take about 2.4 GB.  The old
+  two-pass recursive version runs as a baseline wherever the tree is
+  shallow enough for recursion.
+
+  usage: equal-paths-bench [--min-nodes N] [--max-nodes N] [--seed S]
+                           [--no-header]
+*/
+
+typedef chrono::steady_clock Clock;
+
+// deepest tree the recursive baseline is run on
+static const int kMaxRecursiveHeight = 10000;
+
+static double secondsSince(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// ---------------------------------------------------------------------------
+// Baseline: the previous implementation, height() then a checking pass
+// ---------------------------------------------------------------------------
+
+static int recursiveHeight(Node* root)
+{
+    if(!root) return 0;
+    return 1 + max(recursiveHeight(root->left), recursiveHeight(root->right));
+}
+
+static bool recursiveHelper(Node* root, int cHeight, int height)
+{
+    if(!root) return true;
+    if(!root->left && !root->right) return cHeight == height;
+    return recursiveHelper(root->left, cHeight + 1, height) &&
+           recursiveHelper(root->right, cHeight + 1, height);
+}
+
+static bool recursiveEqualPaths(Node* root)
+{
+    return recursiveHelper(root, 1, recursiveHeight(root));
+}
+
+// ---------------------------------------------------------------------------
+// Tree generation.  Each builder fills nodes and returns the tree height.
+// ---------------------------------------------------------------------------
+
+// node i has children 2i + 1 and 2i + 2
+static int buildBalanced(vector<Node>& nodes, uint64_t n)
+{
+    uint64_t size = 1;
+    int height = 0;
+    while(size * 2 + 1 <= n) {
+        size = size * 2 + 1;
+        height++;
+    }
+    for(uint64_t i = 0; i < size; i++) nodes.push_back(Node((int)i));
+    for(uint64_t i = 0; 2 * i + 2 < size; i++) {
+        nodes[i].left = &nodes[2 * i + 1];
+        nodes[i].right = &nodes[2 * i + 2];
+    }
+    return height + 1;
+}
+
+static int buildSkewed(vector<Node>& nodes, uint64_t n)
+{
+    for(uint64_t i = 0; i < n; i++) nodes.push_back(Node((int)(n - i)));
+    for(uint64_t i = 0; i + 1 < n; i++) nodes[i].left = &nodes[i + 1];
+    return (int)n;
+}
+
+// splits every subtree size at a uniform position, without recursion
+static int buildRandom(vector<Node>& nodes, uint64_t n, uint64_t seed)
+{
+    struct Pending { Node** link; uint64_t size; uint64_t firstKey; int depth; };
+    mt19937_64 rng(seed);
+    Node* root = NULL;
+    vector<Pending> stack;
+    Pending first = { &root, n, 0, 1 };
+    stack.push_back(first);
+    int height = 0;
+
+    while(!stack.empty()) {
+        Pending p = stack.back();
+        stack.pop_back();
+        uint64_t leftSize = rng() % p.size;
+        nodes.push_back(Node((int)(p.firstKey + leftSize)));
+        Node* node = &nodes.back();
+        *p.link = node;
+        height = max(height, p.depth);
+        if(leftSize) {
+            Pending left = { &node->left, leftSize, p.firstKey, p.depth + 1 };
+            stack.push_back(left);
+        }
+        if(p.size - leftSize - 1) {
+            Pending right = { &node->right, p.size - leftSize - 1, p.firstKey + leftSize + 1, p.depth + 1 };
+            stack.push_back(right);
+        }
+    }
+    return height;
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t minNodes = 1000, maxNodes = 10000000, seed = 104;
+    bool header = true;
+
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--min-nodes" && hasValue) minNodes = strtoull(argv[++i], NULL, 10);
+        else if(arg == "--max-nodes" && hasValue) maxNodes = strtoull(argv[++i], NULL, 10);
+        else if(arg == "--seed" && hasValue) seed = strtoull(argv[++i], NULL, 10);
+        else if(arg == "--no-header") header = false;
+        else {
+            cerr << "usage: " << argv[0] << " [--min-nodes N] [--max-nodes N] [--seed S] [--no-header]" << endl;
+            return 1;
+        }
+    }
+    if(minNodes < 1) minNodes = 1;
+
+    char stamp[32];
+    time_t now = time(NULL);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    if(header) cout << "run,shape,nodes,height,result,seconds,ns_per_node,recursive_seconds" << endl;
+
+    const char* shapes[] = { "balanced", "skewed", "random" };
+    for(uint64_t n = minNodes; n <= maxNodes; n *= 10) {
+        for(size_t si = 0; si < sizeof(shapes) / sizeof(shapes[0]); si++) {
+            string shape = shapes[si];
+            vector<Node> nodes;
+            nodes.reserve(n);
+            int height;
+            if(shape == "balanced") height = buildBalanced(nodes, n);
+            else if(shape == "skewed") height = buildSkewed(nodes, n);
+            else height = buildRandom(nodes, n, seed + n);
+            Node* root = nodes.empty() ? NULL : &nodes[0];
+
+            Clock::time_point start = Clock::now();
+            bool result = equalPaths(root);
+            double seconds = secondsSince(start);
+
+            cout << stamp << "," << shape << "," << nodes.size() << "," << height << ","
+                 << (result ? "true" : "false") << "," << seconds << ","
+                 << seconds * 1e9 / nodes.size() << ",";
+            if(height <= kMaxRecursiveHeight) {
+                start = Clock::now();
+                bool expected = recursiveEqualPaths(root);
+                cout << secondsSince(start);
+                if(expected != result) cerr << shape << " " << n << ": results differ" << endl;
+            }
+            cout << endl;
+        }
+    }
+    return 0;
+}
@@ -2,42 +2,51 @@
 //if you want to add any #includes like <iostream> you must do them here (before the next endif)
 #include <iostream>
 #include <algorithm>
+#include <utility>
+#include <vector>
 #endif
 
 #include "equal-paths.h"
 using namespace std;
 
 
-// You may add any prototypes of helper functions here
-int height(Node* root); 
-bool equalPathsHelper(Node* root, int cHeight, int height); 
-
-
 bool equalPaths(Node* root) {
-	// calls helper function to ensure that each leaf node is exactly (height) distance away from root
-	// cout << "height: " << height(root) << endl; 
-    return equalPathsHelper(root, 1, height(root)); 
-	
-}
-
-int height (Node* root) {
-	if(!root) return 0; 
-	return 1 + max(height(root->left), height(root->right)); 
+	if(!root) return true;
+
+	// one depth-first pass with an explicit stack, so even a chain of
+	// millions of nodes cannot overflow the call stack.  The walk follows
+	// left children directly and only stacks the right siblings it still
+	// owes, as (node, depth) pairs.
+	vector<pair<Node*, int> > stack;
+	Node* current = root;
+	int depth = 1;
+	int leafDepth = 0;
+
+	for(;;) {
+		// CASE 1: a leaf, whose depth must match the first leaf's
+		if(!current->left && !current->right) {
+			if(!leafDepth) leafDepth = depth;
+			else if(depth != leafDepth) return false;
+
+			if(stack.empty()) return true;
+			current = stack.back().first;
+			depth = stack.back().second;
+			stack.pop_back();
+			continue;
+		}
+
+		// CASE 2: an inner node at or below the first leaf's depth only has
+		// deeper leaves under it
+		if(leafDepth && depth >= leafDepth) return false;
+
+		// CASE 3: go left, remembering the right child for later
+		if(current->left) {
+			if(current->right) stack.push_back(make_pair(current->right, depth + 1));
+			current = current->left;
+		}
+		else {
+			current = current->right;
+		}
+		depth++;
+	}
 }
-
-bool equalPathsHelper(Node* root, int cHeight, int height) {
-    if(!root) return true; 
-
-    // checks if root is a leaf node
-    if(!root->left && !root->right) {
-        // checks if current height of node is equal to height of tree
-        if(cHeight == height) return true; 
-        return false; 	
-    }
-
-    // if root is not a leaf node, recurse to its left and right nodes with cHeight + 1
-    return equalPathsHelper(root->left, cHeight + 1, height) && equalPathsHelper(root->right, cHeight + 1, height); 	
-}
-
-
-
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+#include "intervalbst.h"
+#include "tree-check.h"
+
+using namespace std;
+
+typedef IntervalTree<int,int> Tree;
+typedef map<pair<int,int>,int> Reference;
+
+// the reference intervals overlapping [lo, hi], in (lo, hi) order
+static vector<pair<int,int> > bruteOverlapping(const Reference& ref, int lo, int hi)
+{
+    vector<pair<int,int> > result;
+    for(Reference::const_iterator it = ref.begin(); it != ref.end(); ++it) {
+      if(it->first.first <= hi && lo <= it->first.second) result.push_back(it->first);
+    }
+    return result;
+}
+
+static bool sameOverlaps(const Tree& tree, const Reference& ref, int lo, int hi)
+{
+    vector<Tree::iterator> found;
+    found.push_back(Tree::iterator());
+    // results are appended after what out already holds
+    size_t count = tree.overlapping(lo, hi, found);
+    vector<pair<int,int> > expected = bruteOverlapping(ref, lo, hi);
+    if(count != expected.size() || found.size() != expected.size() + 1) return false;
+    for(size_t i = 0; i < expected.size(); i++) {
+      const Interval<int>& key = found[i + 1]->first;
+      if(key.lo != expected[i].first || key.hi != expected[i].second) return false;
+      if(found[i + 1]->second != ref.find(expected[i])->second) return false;
+    }
+    return tree.overlaps(lo, hi) == !expected.empty();
+}
+
+static void testRandomIntervals(unsigned seed, int span)
+{
+    Tree tree;
+    Reference ref;
+    mt19937 rng(seed);
+    for(int round = 0; round < 20; round++) {
+      for(int i = 0; i < 300; i++) {
+        int lo = rng() % 10000;
+        int hi = lo + rng() % span;
+        if(rng() % 4) {
+          tree.insert(lo, hi, i);
+          ref[make_pair(lo, hi)] = i;
+        }
+        else if(!ref.empty()) {
+          // remove one that exists, found through the reference
+          Reference::iterator it = ref.lower_bound(make_pair(lo, hi));
+          if(it == ref.end()) it = ref.begin();
+          tree.remove(it->first.first, it->first.second);
+          ref.erase(it);
+        }
+      }
+      CHECK(tree.size() == ref.size());
+      CHECK(tree.isBalanced());
+      bool ok = true;
+      for(int q = 0; q < 100 && ok; q++) {
+        int lo = rng() % 10400 - 200;
+        int hi = lo + rng() % (span * 2);
+        ok = sameOverlaps(tree, ref, lo, hi);
+      }
+      CHECK(ok);
+    }
+}
+
+static void testEdges()
+{
+    Tree tree;
+    Reference ref;
+    CHECK(!tree.overlaps(0, 100));
+    CHECK(sameOverlaps(tree, ref, 0, 100));
+
+    // closed intervals: touching endpoints overlap
+    tree.insert(10, 20, 1);
+    ref[make_pair(10, 20)] = 1;
+    CHECK(tree.overlaps(20, 30) && tree.overlaps(0, 10) && tree.overlaps(15, 15));
+    CHECK(!tree.overlaps(21, 30) && !tree.overlaps(0, 9));
+
+    // the same interval again overwrites; a point interval is allowed
+    tree.insert(10, 20, 2);
+    ref[make_pair(10, 20)] = 2;
+    tree.insert(5, 5, 3);
+    ref[make_pair(5, 5)] = 3;
+    tree.insert(10, 12, 4);
+    ref[make_pair(10, 12)] = 4;
+    CHECK(tree.size() == 3);
+    CHECK(sameOverlaps(tree, ref, 5, 11));
+    CHECK(sameOverlaps(tree, ref, 13, 13));
+
+    tree.remove(10, 20);
+    ref.erase(make_pair(10, 20));
+    CHECK(!tree.overlaps(13, 30));
+    CHECK(sameOverlaps(tree, ref, 0, 100));
+}
+
+int main()
+{
+    testRandomIntervals(1, 50);
+    testRandomIntervals(2, 3000);
+    testEdges();
+    return checkResult("intervalbst-test");
+}
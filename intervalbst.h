@@ -0,0 +1,152 @@
+#ifndef INTERVALBST_H
+#define INTERVALBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include "aggregatebst.h"
+
+/**
+* A closed interval [lo, hi], the key type of IntervalTree.  Intervals are
+* ordered by lo, then hi.
+*/
+template <typename T>
+struct Interval
+{
+    Interval(const T& lo, const T& hi) : lo(lo), hi(hi) { }
+
+    T lo;
+    T hi;
+};
+
+template <typename T>
+bool operator<(const Interval<T>& a, const Interval<T>& b)
+{
+    return a.lo < b.lo || (!(b.lo < a.lo) && a.hi < b.hi);
+}
+
+template <typename T>
+bool operator==(const Interval<T>& a, const Interval<T>& b)
+{
+    return !(a < b) && !(b < a);
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const Interval<T>& i)
+{
+    return os << "[" << i.lo << ", " << i.hi << "]";
+}
+
+/**
+* Monoid for IntervalTree: the largest right endpoint in a subtree.
+*/
+template <typename T>
+struct MaxEndAggregate
+{
+    typedef T type;
+    static T identity() { return std::numeric_limits<T>::lowest(); }
+    static T combine(const T& a, const T& b) { return std::max(a, b); }
+    template <typename Value>
+    static T lift(const Interval<T>& key, const Value&) { return key.hi; }
+};
+
+/**
+* A tree of closed intervals [lo, hi], each with a value.  Intervals are keyed
+* by (lo, hi), so each interval is stored once and inserting it again overwrites
+* its value.  It is an AVL tree (including relaxed mode) whose nodes also track
+* the largest hi in their subtree, which lets overlap queries skip every
+* subtree that ends before the query starts.
+*/
+template <class T, class Value>
+class IntervalTree : public AggregateAVLTree<Interval<T>, Value, MaxEndAggregate<T> >
+{
+public:
+    typedef Interval<T> interval_type;
+    typedef typename BinarySearchTree<interval_type, Value>::iterator iterator;
+
+    void insert(const T& lo, const T& hi, const Value& value);
+    void remove(const T& lo, const T& hi);
+    using AggregateAVLTree<interval_type, Value, MaxEndAggregate<T> >::insert;
+    using AggregateAVLTree<interval_type, Value, MaxEndAggregate<T> >::remove;
+
+    // appends the intervals overlapping [lo, hi] to out in key order and
+    // returns how many were found
+    size_t overlapping(const T& lo, const T& hi, std::vector<iterator>& out) const;
+    // true if any interval overlaps [lo, hi]
+    bool overlaps(const T& lo, const T& hi) const;
+
+protected:
+    typedef AggregateNode<interval_type, Value, T> INode;
+
+    void overlappingHelper(INode* n, const T& lo, const T& hi, std::vector<iterator>& out) const;
+};
+
+/*
+ * Recall: If the interval is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class T, class Value>
+void IntervalTree<T, Value>::insert(const T& lo, const T& hi, const Value& value)
+{
+    if(hi < lo) throw std::invalid_argument("Invalid interval");
+    this->insert(std::make_pair(interval_type(lo, hi), value));
+}
+
+template<class T, class Value>
+void IntervalTree<T, Value>::remove(const T& lo, const T& hi)
+{
+    this->remove(interval_type(lo, hi));
+}
+
+template<class T, class Value>
+size_t IntervalTree<T, Value>::overlapping(const T& lo, const T& hi, std::vector<iterator>& out) const
+{
+    size_t before = out.size();
+    if(!(hi < lo)) overlappingHelper(static_cast<INode*>(this->root_), lo, hi, out);
+    return out.size() - before;
+}
+
+/**
+* In-order walk that skips subtrees whose largest endpoint is below lo, and
+* everything right of a node that starts after hi.
+*/
+template<class T, class Value>
+void IntervalTree<T, Value>::overlappingHelper(INode* n, const T& lo, const T& hi, std::vector<iterator>& out) const
+{
+    while(n && !(n->getAggregate() < lo)) {
+      overlappingHelper(n->getLeft(), lo, hi, out);
+
+      // CASE 1: n and its right subtree start after the query ends
+      if(hi < n->getKey().lo) return;
+      // CASE 2: n starts in time and ends in time, so it overlaps
+      if(!(n->getKey().hi < lo)) out.push_back(this->makeIterator(n));
+      // CASE 3: continue with the right subtree
+      n = n->getRight();
+    }
+}
+
+/**
+* Descends only towards a subtree that can hold an overlap, so this is
+* O(log n).
+*/
+template<class T, class Value>
+bool IntervalTree<T, Value>::overlaps(const T& lo, const T& hi) const
+{
+    if(hi < lo) return false;
+    INode* n = static_cast<INode*>(this->root_);
+    while(n) {
+      if(!(n->getKey().hi < lo) && !(hi < n->getKey().lo)) return true;
+      // the left subtree holds an interval reaching lo; if none of them
+      // overlaps, they all start after hi and so does everything to the right
+      if(n->getLeft() && !(n->getLeft()->getAggregate() < lo)) n = n->getLeft();
+      else n = n->getRight();
+    }
+    return false;
+}
+
+#endif
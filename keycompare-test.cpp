@@ -0,0 +1,185 @@
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "keycompare.h"
+#include "tree-check.h"
+
+using namespace std;
+
+// three-way and descending: negative when a is the larger key
+struct DescendingCompare
+{
+    int operator()(int a, int b) const
+    {
+        return (a < b) - (b < a);
+    }
+};
+
+// three-way comparator that counts its calls
+static size_t g_compares = 0;
+
+struct CountingCompare
+{
+    int operator()(int a, int b) const
+    {
+        g_compares++;
+        return threeWayCompare(a, b);
+    }
+};
+
+// a lookup type that is not the key type; the transparent comparator below
+// orders it against int keys by its id
+struct Record
+{
+    int id;
+    const char* name;
+};
+
+struct RecordCompare
+{
+    typedef void is_transparent;
+
+    int operator()(int a, int b) const { return threeWayCompare(a, b); }
+    int operator()(const Record& a, int b) const { return threeWayCompare(a.id, b); }
+    int operator()(int a, const Record& b) const { return threeWayCompare(a, b.id); }
+};
+
+// a few thousand keys over a small alphabet, so many share long prefixes
+static string makeKey(unsigned n)
+{
+    string key = "key/";
+    for(; n; n /= 5) key += (char)('a' + n % 5);
+    return key;
+}
+
+/**
+* Random inserts, overwrites and removes on tree, mirrored in ref, a
+* std::map with the same order.  Afterwards the in-order items and every
+* lookup must agree with the map.
+*/
+template<typename Tree, typename Map, typename MakeKey>
+void mixedOps(Tree& tree, Map& ref, unsigned seed, int ops, unsigned keys, MakeKey makeKey)
+{
+    mt19937 rng(seed);
+    for(int i = 0; i < ops; i++) {
+      typename Map::key_type key = makeKey(rng() % keys);
+      if(rng() % 3) {
+        tree.insert(make_pair(key, i));
+        ref[key] = i;
+      }
+      else {
+        tree.remove(key);
+        ref.erase(key);
+      }
+    }
+    CHECK(tree.size() == ref.size());
+    CHECK(sameItems(tree, ref));
+
+    bool ok = true;
+    for(unsigned n = 0; n < keys; n++) {
+      typename Map::key_type key = makeKey(n);
+      typename Tree::iterator it = tree.find(key);
+      typename Map::iterator r = ref.find(key);
+      ok = ok && (it == tree.end()) == (r == ref.end());
+      ok = ok && (r == ref.end() || it->second == r->second);
+      typename Tree::iterator lb = tree.lower_bound(key);
+      typename Map::iterator rlb = ref.lower_bound(key);
+      ok = ok && (lb == tree.end() ? rlb == ref.end() : rlb != ref.end() && lb->first == rlb->first);
+    }
+    CHECK(ok);
+}
+
+static int identity(unsigned n)
+{
+    return (int)n;
+}
+
+// three-way comparators give the same trees as the matching less-than ones
+static void testThreeWay()
+{
+    {
+      BinarySearchTree<string, int, ThreeWayCompare<> > tree;
+      map<string, int> ref;
+      mixedOps(tree, ref, 1, 20000, 3000, makeKey);
+    }
+    {
+      AVLTree<string, int, ThreeWayCompare<string> > tree;
+      map<string, int> ref;
+      mixedOps(tree, ref, 2, 20000, 3000, makeKey);
+      CHECK(tree.isBalanced());
+    }
+    {
+      AVLTree<int, int, DescendingCompare> tree;
+      map<int, int, greater<int> > ref;
+      mixedOps(tree, ref, 3, 20000, 3000, identity);
+      CHECK(tree.isBalanced());
+      CHECK(tree.begin()->first == ref.begin()->first);
+    }
+    {
+      RedBlackTree<int, int, DescendingCompare> tree;
+      map<int, int, greater<int> > ref;
+      mixedOps(tree, ref, 4, 20000, 3000, identity);
+    }
+    // a less-than comparator other than std::less
+    {
+      AVLTree<int, int, greater<int> > tree;
+      map<int, int, greater<int> > ref;
+      mixedOps(tree, ref, 5, 20000, 3000, identity);
+      CHECK(tree.isBalanced());
+    }
+}
+
+// a three-way comparator is called once per level of a descent
+static void testOneComparePerLevel()
+{
+    AVLTree<int, int, CountingCompare> tree;
+    for(int i = 0; i < 4096; i++) tree.insert(make_pair(i * 3, i));
+    bool ok = true;
+    for(int key = -1; key < 4096 * 3; key += 7) {
+      g_compares = 0;
+      tree.find(key);
+      ok = ok && g_compares <= (size_t)tree.height();
+    }
+    CHECK(ok);
+}
+
+// transparent comparators look up by other types without building a key
+static void testTransparentFind()
+{
+    AVLTree<string, int, ThreeWayCompare<> > tree;
+    map<string, int> ref;
+    mixedOps(tree, ref, 6, 5000, 800, makeKey);
+    const AVLTree<string, int, ThreeWayCompare<> >& constTree = tree;
+
+    bool ok = true;
+    for(unsigned n = 0; n < 800; n++) {
+      string key = makeKey(n);
+      const char* raw = key.c_str();
+      AVLTree<string, int, ThreeWayCompare<> >::iterator it = tree.find(raw);
+      ok = ok && it == tree.find(key) && constTree.find(raw) == constTree.find(key);
+      ok = ok && (it == tree.end() ? ref.count(key) == 0 : it->second == ref[key]);
+    }
+    ok = ok && tree.find("") == tree.end() && tree.find("key/zzz") == tree.end();
+    CHECK(ok);
+
+    AVLTree<int, const char*, RecordCompare> records;
+    const char* names[] = { "ann", "bob", "cy", "dee", "eve" };
+    for(int i = 0; i < 5; i++) records.insert(make_pair(i * 10, names[i]));
+    Record probe = { 30, "" };
+    CHECK(records.find(probe) != records.end() && records.find(probe)->second == names[3]);
+    Record missing = { 31, "" };
+    CHECK(records.find(missing) == records.end());
+}
+
+int main()
+{
+    testThreeWay();
+    testOneComparePerLevel();
+    testTransparentFind();
+    return checkResult("keycompare-test");
+}
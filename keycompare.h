@@ -0,0 +1,95 @@
+#ifndef KEYCOMPARE_H
+#define KEYCOMPARE_H
+
+#include <string>
+#include <functional>
+#include <type_traits>
+
+/**
+* Key comparison shared by the search trees.  A tree's Compare parameter is
+* either a less-than predicate returning bool (e.g. std::less<Key>) or a
+* three-way comparator returning int (e.g. ThreeWayCompare).
+*/
+
+/**
+* Three-way comparison: negative if a orders before b, zero if they are
+* equivalent, positive otherwise.  Strings use std::string::compare so each
+* comparison walks the characters once; everything else falls back to <.
+*/
+template<typename A, typename B>
+int threeWayCompare(const A& a, const B& b)
+{
+    return (a < b) ? -1 : ((b < a) ? 1 : 0);
+}
+
+inline int threeWayCompare(const std::string& a, const std::string& b)
+{
+    return a.compare(b);
+}
+
+inline int threeWayCompare(const std::string& a, const char* b)
+{
+    return a.compare(b);
+}
+
+inline int threeWayCompare(const char* a, const std::string& b)
+{
+    int r = b.compare(a);
+    return (r > 0) ? -1 : (r < 0);
+}
+
+/**
+* A three-way comparator for the trees' Compare parameter, so a descent
+* makes one comparison per level.  ThreeWayCompare<> (i.e. <void>) is
+* transparent: it compares mixed types, so e.g. find("abc") on a tree with
+* std::string keys never builds a std::string.
+*/
+template<typename T = void>
+struct ThreeWayCompare
+{
+    int operator()(const T& a, const T& b) const
+    {
+        return threeWayCompare(a, b);
+    }
+};
+
+template<>
+struct ThreeWayCompare<void>
+{
+    typedef void is_transparent;
+
+    template<typename A, typename B>
+    int operator()(const A& a, const B& b) const
+    {
+        return threeWayCompare(a, b);
+    }
+};
+
+// less-than comparator: one call when a orders first, two otherwise
+template<typename Compare, typename A, typename B>
+int compareWith(const Compare& comp, const A& a, const B& b, std::true_type)
+{
+    if(comp(a, b)) return -1;
+    return comp(b, a) ? 1 : 0;
+}
+
+// three-way comparator: one call
+template<typename Compare, typename A, typename B>
+int compareWith(const Compare& comp, const A& a, const B& b, std::false_type)
+{
+    return comp(a, b);
+}
+
+/**
+* Compares a and b with comp: negative if a orders before b, zero if they are
+* equivalent, positive otherwise.  Comparators returning bool are treated as
+* less-than predicates, anything else as three-way.
+*/
+template<typename Compare, typename A, typename B>
+int compareWith(const Compare& comp, const A& a, const B& b)
+{
+    return compareWith(comp, a, b,
+        typename std::is_same<decltype(comp(a, b)), bool>::type());
+}
+
+#endif
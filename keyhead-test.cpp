@@ -0,0 +1,175 @@
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "keyhead.h"
+#include "tree-check.h"
+
+using namespace std;
+
+// true if every node's cached head matches its key, and nodes is its count
+template<typename NodeT>
+bool headsMatch(const NodeT* root, size_t nodes)
+{
+    vector<const NodeT*> stack;
+    if(root) stack.push_back(root);
+    size_t seen = 0;
+    while(!stack.empty()) {
+      const NodeT* n = stack.back();
+      stack.pop_back();
+      if(n->getHead() != keyHeadOf(n->getKey())) return false;
+      seen++;
+      if(n->getLeft()) stack.push_back(n->getLeft());
+      if(n->getRight()) stack.push_back(n->getRight());
+    }
+    return seen == nodes;
+}
+
+/**
+* Keys that defeat the heads: long shared prefixes (equal heads, decided by
+* the body), keys shorter than 8 bytes, the empty key, embedded and trailing
+* '\0' bytes (which look like head padding) and bytes above 0x7f (which must
+* order as unsigned).
+*/
+static vector<string> trickyKeys()
+{
+    vector<string> keys;
+    const string prefixes[] = { "", "a", "abcdefg", "abcdefgh", "/usr/local/share/", "/usr/local/shared" };
+    const string tails[] = { "", "x", "y", "xy", string(1, '\0'), string(2, '\0'), "\x7f", "\x80", "\xff",
+                             string("\0x", 2), "longer tail that goes on" };
+    for(size_t p = 0; p < sizeof(prefixes) / sizeof(prefixes[0]); p++) {
+      for(size_t t = 0; t < sizeof(tails) / sizeof(tails[0]); t++) keys.push_back(prefixes[p] + tails[t]);
+    }
+    for(int i = 0; i < 500; i++) {
+      string key = "customer/000000";
+      for(int n = i; n; n /= 7) key += (char)('0' + n % 7);
+      keys.push_back(key);
+    }
+    return keys;
+}
+
+// heads are big-endian, zero padded, and order like the bytes they hold
+static void testHeadOf()
+{
+    CHECK(keyHeadOf(string("")) == 0);
+    CHECK(keyHeadOf(string("a")) == 0x6100000000000000ULL);
+    CHECK(keyHeadOf(string("abcdefgh")) == 0x6162636465666768ULL);
+    CHECK(keyHeadOf(string("abcdefghijk")) == keyHeadOf(string("abcdefgh")));
+    CHECK(keyHeadOf(string("\xff")) == 0xff00000000000000ULL);
+    CHECK(keyHeadOf("abc") == keyHeadOf(string("abc")));
+    CHECK(keyHeadOf("abcdefghij") == keyHeadOf(string("abcdefghij")));
+
+    // whenever two heads differ they agree with the full comparison
+    vector<string> keys = trickyKeys();
+    bool ok = true;
+    for(size_t i = 0; i < keys.size(); i++) {
+      for(size_t j = 0; j < keys.size(); j++) {
+        uint64_t a = keyHeadOf(keys[i]), b = keyHeadOf(keys[j]);
+        if(a != b) ok = ok && (a < b) == (keys[i] < keys[j]);
+      }
+    }
+    CHECK(ok);
+}
+
+/**
+* Mixed inserts and removes of the tricky keys, mirrored in a std::map.
+* The heads must follow their keys through node swaps on removal, and
+* lookups must agree with the map.
+*/
+template<typename Tree>
+void testTree(unsigned seed)
+{
+    vector<string> keys = trickyKeys();
+    Tree tree;
+    map<string, int> ref;
+    mt19937 rng(seed);
+    for(int i = 0; i < 20000; i++) {
+      const string& key = keys[rng() % keys.size()];
+      if(rng() % 3) {
+        tree.insert(make_pair(key, i));
+        ref[key] = i;
+      }
+      else {
+        tree.remove(key);
+        ref.erase(key);
+      }
+    }
+    CHECK(sameItems(tree, ref));
+    CHECK(headsMatch(tree.rootNode(), tree.size()));
+
+    bool ok = true;
+    for(size_t i = 0; i < keys.size(); i++) {
+      typename Tree::iterator it = tree.find(keys[i]);
+      map<string, int>::iterator r = ref.find(keys[i]);
+      ok = ok && (it == tree.end()) == (r == ref.end());
+      ok = ok && (r == ref.end() || it->second == r->second);
+      typename Tree::iterator lb = tree.lower_bound(keys[i]);
+      map<string, int>::iterator rlb = ref.lower_bound(keys[i]);
+      ok = ok && (lb == tree.end() ? rlb == ref.end() : rlb != ref.end() && lb->first == rlb->first);
+    }
+    CHECK(ok);
+
+    // copies and node handles carry the heads along
+    Tree copy(tree);
+    CHECK(headsMatch(copy.rootNode(), copy.size()));
+    Tree other;
+    for(size_t i = 0; i < keys.size(); i += 3) {
+      typename Tree::node_type nh = copy.extract(keys[i]);
+      if(!nh.empty()) other.insert(std::move(nh));
+    }
+    CHECK(headsMatch(copy.rootNode(), copy.size()));
+    CHECK(headsMatch(other.rootNode(), other.size()));
+    CHECK(copy.size() + other.size() == tree.size());
+}
+
+// const char* lookups use the heads too, without building a std::string
+static void testTransparentFind()
+{
+    AVLTree<string, int, ThreeWayCompare<> > tree;
+    vector<string> keys = trickyKeys();
+    for(size_t i = 0; i < keys.size(); i += 2) tree.insert(make_pair(keys[i], (int)i));
+
+    bool ok = true;
+    for(size_t i = 0; i < keys.size(); i++) {
+      // a C string ends at the first '\0', so only keys without one
+      if(keys[i].find('\0') != string::npos) continue;
+      AVLTree<string, int, ThreeWayCompare<> >::iterator it = tree.find(keys[i].c_str());
+      ok = ok && it == tree.find(keys[i]);
+    }
+    CHECK(ok);
+}
+
+// an order that is not byte-wise leaves the heads unused, and still works
+static void testOtherOrder()
+{
+    static_assert(!UsesKeyHead<string, greater<string> >::value, "greater<string> must not use heads");
+    vector<string> keys = trickyKeys();
+    AVLTree<string, int, greater<string> > tree;
+    map<string, int, greater<string> > ref;
+    for(size_t i = 0; i < keys.size(); i++) {
+      tree.insert(make_pair(keys[i], (int)i));
+      ref[keys[i]] = (int)i;
+    }
+    for(size_t i = 0; i < keys.size(); i += 4) {
+      tree.remove(keys[i]);
+      ref.erase(keys[i]);
+    }
+    CHECK(sameItems(tree, ref));
+    CHECK(tree.isBalanced());
+}
+
+int main()
+{
+    testHeadOf();
+    testTree<BinarySearchTree<string, int> >(1);
+    testTree<AVLTree<string, int> >(2);
+    testTree<RedBlackTree<string, int> >(3);
+    testTree<AVLTree<string, int, ThreeWayCompare<string> > >(4);
+    testTransparentFind();
+    testOtherOrder();
+    return checkResult("keyhead-test");
+}
@@ -0,0 +1,131 @@
+#ifndef KEYHEAD_H
+#define KEYHEAD_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <functional>
+#include <type_traits>
+#include "keycompare.h"
+
+/**
+* Key heads: the first 8 bytes of a string key packed big-endian (zero padded)
+* into a uint64_t.  For byte-wise (ordinal) string orders, two keys whose heads
+* differ compare exactly like their heads, so a descent can usually decide
+* without touching the string bodies, which live in a separate heap block.
+* Equal heads say nothing and fall back to the full comparison.
+*/
+
+inline uint64_t keyHeadOf(const char* s, size_t n)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if(n >= 8) {
+        uint64_t h;
+        std::memcpy(&h, s, 8);
+        return __builtin_bswap64(h);
+    }
+#endif
+    uint64_t h = 0;
+    for(size_t i = 0; i < 8; i++) {
+        h = (h << 8) | (i < n ? (unsigned char)s[i] : 0);
+    }
+    return h;
+}
+
+inline uint64_t keyHeadOf(const std::string& s)
+{
+    return keyHeadOf(s.data(), s.size());
+}
+
+inline uint64_t keyHeadOf(const char* s)
+{
+    size_t n = 0;
+    while(n < 8 && s[n]) n++;
+    return keyHeadOf(s, n);
+}
+
+/**
+* Base class of Node holding the key head.  It is empty (and takes no space
+* in the node) for every key type but std::string.
+*/
+template<typename Key>
+class KeyHead
+{
+public:
+    explicit KeyHead(const Key&) { }
+};
+
+template<>
+class KeyHead<std::string>
+{
+public:
+    explicit KeyHead(const std::string& key) : head_(keyHeadOf(key)) { }
+    uint64_t getHead() const { return head_; }
+
+protected:
+    uint64_t head_;
+};
+
+/**
+* True when Compare orders Key byte-wise, so that heads may decide
+* comparisons.  std::less<std::string> qualifies because char_traits<char>
+* compares characters as unsigned char.
+*/
+template<typename Key, typename Compare>
+struct UsesKeyHead : std::false_type { };
+
+template<>
+struct UsesKeyHead<std::string, std::less<std::string> > : std::true_type { };
+
+template<>
+struct UsesKeyHead<std::string, ThreeWayCompare<std::string> > : std::true_type { };
+
+template<>
+struct UsesKeyHead<std::string, ThreeWayCompare<> > : std::true_type { };
+
+/**
+* A search key prepared for one descent.  compare(n) orders the key against
+* node n like compareWith(comp, key, n->getKey()), but when heads apply the
+* key's head is computed once up front and compared first.
+*/
+template<typename Key, typename Compare, typename K,
+         bool Heads = UsesKeyHead<Key, Compare>::value &&
+                      (std::is_same<K, std::string>::value ||
+                       std::is_convertible<const K&, const char*>::value)>
+class KeyProbe
+{
+public:
+    KeyProbe(const Compare& comp, const K& key) : comp_(comp), key_(key) { }
+
+    template<typename N>
+    int compare(const N* n) const
+    {
+        return compareWith(comp_, key_, n->getKey());
+    }
+
+protected:
+    const Compare& comp_;
+    const K& key_;
+};
+
+template<typename Key, typename Compare, typename K>
+class KeyProbe<Key, Compare, K, true>
+{
+public:
+    KeyProbe(const Compare& comp, const K& key) : comp_(comp), key_(key), head_(keyHeadOf(key)) { }
+
+    template<typename N>
+    int compare(const N* n) const
+    {
+        uint64_t h = n->getHead();
+        if(head_ != h) return (head_ < h) ? -1 : 1;
+        return compareWith(comp_, key_, n->getKey());
+    }
+
+protected:
+    const Compare& comp_;
+    const K& key_;
+    uint64_t head_;
+};
+
+#endif
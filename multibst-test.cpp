@@ -0,0 +1,116 @@
+#include <iostream>
+#include <map>
+#include <random>
+#include "multibst.h"
+#include "tree-check.h"
+
+using namespace std;
+
+typedef multimap<int,int> Reference;
+
+template<typename Tree>
+bool sameEqualRanges(const Tree& tree, const Reference& ref, int keys)
+{
+    for(int key = 0; key < keys; key++) {
+      if(tree.count(key) != ref.count(key)) return false;
+      pair<typename Tree::const_iterator, typename Tree::const_iterator> range = tree.equal_range(key);
+      pair<Reference::const_iterator, Reference::const_iterator> expected = ref.equal_range(key);
+      // duplicates come back in insertion order
+      for(; range.first != range.second; ++range.first, ++expected.first) {
+        if(expected.first == expected.second || range.first->second != expected.first->second) return false;
+      }
+      if(expected.first != expected.second) return false;
+      typename Tree::const_iterator it = tree.find(key);
+      if((it == tree.end()) != (ref.find(key) == ref.end())) return false;
+      if(it != tree.end() && it->first != key) return false;
+    }
+    return true;
+}
+
+// inserts with many duplicates, single erases and remove() of whole keys
+template<typename Tree, typename Valid>
+void testDuplicates(unsigned seed, Valid valid)
+{
+    Tree tree;
+    Reference ref;
+    mt19937 rng(seed);
+    const int keys = 300;
+    for(int round = 0; round < 20; round++) {
+      for(int i = 0; i < 1000; i++) {
+        int key = rng() % keys;
+        int op = rng() % 10;
+        if(op < 7) {
+          tree.insert(make_pair(key, round * 1000 + i));
+          ref.insert(make_pair(key, round * 1000 + i));
+        }
+        else if(op < 9) {
+          // erase the first of the duplicates only
+          typename Tree::iterator it = tree.lower_bound(key);
+          Reference::iterator r = ref.lower_bound(key);
+          if(r != ref.end() && r->first == key) {
+            tree.erase(it);
+            ref.erase(r);
+          }
+        }
+        else {
+          tree.remove(key);
+          ref.erase(key);
+        }
+      }
+      CHECK(tree.size() == ref.size());
+      CHECK(valid(tree));
+      CHECK(sameItems(tree, ref));
+      CHECK(sameEqualRanges(tree, ref, keys));
+    }
+
+    // node handles keep their place after the existing duplicates
+    int key = ref.begin()->first;
+    typename Tree::node_type handle = tree.extract(tree.begin());
+    Reference::iterator first = ref.begin();
+    ref.insert(make_pair(first->first, first->second));
+    ref.erase(first);
+    tree.insert(std::move(handle));
+    CHECK(sameEqualRanges(tree, ref, keys));
+
+    // a range erase that cuts a run of duplicates in two
+    typename Tree::iterator lo = tree.lower_bound(key);
+    ++lo;
+    Reference::iterator refLo = ref.lower_bound(key);
+    ++refLo;
+    tree.erase(lo, tree.upper_bound(key + 20));
+    ref.erase(refLo, ref.upper_bound(key + 20));
+    CHECK(valid(tree));
+    CHECK(sameItems(tree, ref));
+
+    tree.rebalance();
+    CHECK(valid(tree));
+    CHECK(sameItems(tree, ref));
+    CHECK(sameEqualRanges(tree, ref, keys));
+}
+
+static bool multiBSTValid(const MultiBinarySearchTree<int,int>&)
+{
+    return true;
+}
+
+static bool multiAVLValid(const MultiAVLTree<int,int>& tree)
+{
+    return tree.isBalanced() && tree.verifyStatistics();
+}
+
+int main()
+{
+    testDuplicates<MultiBinarySearchTree<int,int> >(1, multiBSTValid);
+    testDuplicates<MultiAVLTree<int,int> >(2, multiAVLValid);
+
+    MultiAVLTree<int,int> tree;
+    tree.setRelaxed(true, 0);
+    for(int i = 0; i < 2000; i++) tree.insert(make_pair(i % 3, i));
+    tree.finishRebalance();
+    CHECK(tree.count(1) == 667 && tree.isBalanced());
+    tree.remove(1);
+    CHECK(tree.count(1) == 0 && tree.size() == 1333 && tree.verifyStatistics());
+    tree.finishRebalance();
+    CHECK(tree.isBalanced());
+    return checkResult("multibst-test");
+}
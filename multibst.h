@@ -0,0 +1,203 @@
+#ifndef MULTIBST_H
+#define MULTIBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <utility>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* Multimap variants of BinarySearchTree and AVLTree.  insert() always adds a
+* node, so equal keys are kept as separate items.  A new key goes right of
+* every equal key already in the tree, so iteration (and equal_range) visits
+* duplicates in insertion order.  remove(key) removes every item with that
+* key; find() and operator[] return one of them.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class MultiBinarySearchTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    MultiBinarySearchTree();
+    explicit MultiBinarySearchTree(const Compare& comp);
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    using BinarySearchTree<Key, Value, Compare>::insert;
+
+protected:
+    virtual Node<Key, Value>* attachNode(Node<Key, Value>* n);
+};
+
+template <class Key, class Value, class Compare = std::less<Key> >
+class MultiAVLTree : public AVLTree<Key, Value, Compare>
+{
+public:
+    MultiAVLTree();
+    explicit MultiAVLTree(const Compare& comp);
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    using AVLTree<Key, Value, Compare>::insert;
+
+protected:
+    virtual Node<Key, Value>* attachNode(Node<Key, Value>* n);
+    virtual bool uniqueKeys() const;
+};
+
+/*
+------------------------------------------------------------
+Begin implementations for the MultiBinarySearchTree class.
+------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+MultiBinarySearchTree<Key, Value, Compare>::MultiBinarySearchTree()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+MultiBinarySearchTree<Key, Value, Compare>::MultiBinarySearchTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp)
+{
+
+}
+
+// equal keys descend right, so the new node lands after them in order
+template<class Key, class Value, class Compare>
+void MultiBinarySearchTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* parent = nullptr;
+    bool left = false;
+    size_t depth = 0;
+    KeyProbe<Key, Compare, Key> probe(this->comp_, keyValuePair.first);
+
+    while(current) {
+      parent = current;
+      depth++;
+      left = probe.compare(current) < 0;
+      current = left ? current->getLeft() : current->getRight();
+    }
+
+    current = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent);
+    if(!parent) this->root_ = current;
+    else if(left) parent->setLeft(current);
+    else parent->setRight(current);
+    this->leafLinked(current);
+    this->leafInserted(depth);
+}
+
+// links n in after any equal keys, like insert
+template<class Key, class Value, class Compare>
+Node<Key, Value>* MultiBinarySearchTree<Key, Value, Compare>::attachNode(Node<Key, Value>* n)
+{
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* parent = nullptr;
+    bool left = false;
+    KeyProbe<Key, Compare, Key> probe(this->comp_, n->getKey());
+
+    while(current) {
+      parent = current;
+      left = probe.compare(current) < 0;
+      current = left ? current->getLeft() : current->getRight();
+    }
+
+    n->setParent(parent);
+    if(!parent) this->root_ = n;
+    else if(left) parent->setLeft(n);
+    else parent->setRight(n);
+    this->leafLinked(n);
+    return n;
+}
+
+template<class Key, class Value, class Compare>
+void MultiBinarySearchTree<Key, Value, Compare>::remove(const Key& key)
+{
+    Node<Key, Value>* current;
+    while((current = this->internalFind(key))) delete this->unlinkNode(current);
+}
+
+/*
+----------------------------------------------------------
+End implementations for the MultiBinarySearchTree class.
+----------------------------------------------------------
+*/
+
+/*
+-------------------------------------------------
+Begin implementations for the MultiAVLTree class.
+-------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+MultiAVLTree<Key, Value, Compare>::MultiAVLTree()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+MultiAVLTree<Key, Value, Compare>::MultiAVLTree(const Compare& comp) :
+    AVLTree<Key, Value, Compare>(comp)
+{
+
+}
+
+// equal keys descend right, so the new node lands after them in order
+template<class Key, class Value, class Compare>
+void MultiAVLTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    AVLNode<Key, Value>* current = static_cast<AVLNode<Key, Value>*>(this->root_);
+    AVLNode<Key, Value>* parent = nullptr;
+    bool left = false;
+    KeyProbe<Key, Compare, Key> probe(this->comp_, keyValuePair.first);
+
+    while(current) {
+      parent = current;
+      left = probe.compare(current) < 0;
+      current = left ? current->getLeft() : current->getRight();
+    }
+
+    this->insertLeaf(parent, left, keyValuePair);
+}
+
+// links n in after any equal keys, like insert
+template<class Key, class Value, class Compare>
+Node<Key, Value>* MultiAVLTree<Key, Value, Compare>::attachNode(Node<Key, Value>* n)
+{
+    AVLNode<Key, Value>* current = static_cast<AVLNode<Key, Value>*>(this->root_);
+    AVLNode<Key, Value>* parent = nullptr;
+    bool left = false;
+    KeyProbe<Key, Compare, Key> probe(this->comp_, n->getKey());
+
+    while(current) {
+      parent = current;
+      left = probe.compare(current) < 0;
+      current = left ? current->getLeft() : current->getRight();
+    }
+
+    return this->linkLeaf(parent, left, static_cast<AVLNode<Key, Value>*>(n));
+}
+
+// equal keys may sit on either side of each other after rotations
+template<class Key, class Value, class Compare>
+bool MultiAVLTree<Key, Value, Compare>::uniqueKeys() const
+{
+    return false;
+}
+
+// rotations and predecessor swaps keep the in-order sequence, so the
+// remaining duplicates of other keys stay in insertion order
+template<class Key, class Value, class Compare>
+void MultiAVLTree<Key, Value, Compare>::remove(const Key& key)
+{
+    while(this->internalFind(key)) AVLTree<Key, Value, Compare>::remove(key);
+}
+
+/*
+-----------------------------------------------
+End implementations for the MultiAVLTree class.
+-----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef PARALLEL_BST_H
+#define PARALLEL_BST_H
+
+#include <mutex>
+#include <utility>
+#include "bst.h"
+#include "work-stealing-pool.h"
+
+/**
+* Parallel traversals for batch jobs over every item.  The top levels of the
+* tree are split into disjoint subtrees that run as tasks on a
+* WorkStealingPool (WorkStealingPool::shared() unless one is given), and
+* each part is walked in order through the parent pointers.  The split
+* follows the tree's shape, so a tree that has degenerated into a chain gets
+* little parallelism; rebalance() it first.
+*
+* fn and the reduce operations run on several threads at once.  They may
+* change values but not the tree, and must synchronize anything else they
+* share.  The first exception thrown is rethrown once every task has
+* stopped.
+*/
+template<typename Key, typename Value, typename Compare, typename Function>
+void parallel_for_each(BinarySearchTree<Key, Value, Compare>& tree, Function fn);
+template<typename Key, typename Value, typename Compare, typename Function>
+void parallel_for_each(BinarySearchTree<Key, Value, Compare>& tree, Function fn, WorkStealingPool& pool);
+
+/**
+* Folds the items with accumulate(T, item) -> T, starting every part from a
+* copy of init, and merges the parts with combine(T, T) -> T, so init must
+* be an identity for combine.  With inOrder the parts are merged in key
+* order and combine only needs to be associative; without it they are
+* merged into one total as they finish, which holds fewer partial results
+* but needs combine to be commutative as well.
+*/
+template<typename Key, typename Value, typename Compare, typename T, typename Accumulate, typename Combine>
+T parallel_reduce(const BinarySearchTree<Key, Value, Compare>& tree, T init, Accumulate accumulate,
+                  Combine combine, bool inOrder = true);
+template<typename Key, typename Value, typename Compare, typename T, typename Accumulate, typename Combine>
+T parallel_reduce(const BinarySearchTree<Key, Value, Compare>& tree, T init, Accumulate accumulate,
+                  Combine combine, WorkStealingPool& pool, bool inOrder = true);
+
+/*
+----------------------------------------------------
+Begin implementations for the parallel traversals.
+----------------------------------------------------
+*/
+
+// in-order walk of the subtree under root, using the parent pointers to
+// climb back up, so it needs no stack
+template<typename NodeT, typename Visit>
+void visitSubtree(NodeT* root, Visit& visit)
+{
+    NodeT* current = root;
+    while(current->getLeft()) current = current->getLeft();
+
+    for(;;) {
+      visit(current->getItem());
+      if(current->getRight()) {
+        current = current->getRight();
+        while(current->getLeft()) current = current->getLeft();
+        continue;
+      }
+      // climb past the subtrees we have finished, but not out of root's
+      while(current != root && current->getParent()->getRight() == current) current = current->getParent();
+      if(current == root) return;
+      current = current->getParent();
+    }
+}
+
+// waits for group even when the caller's half throws, since the spawned
+// half still refers to the caller's frame
+template<typename Work>
+void forkJoin(WorkStealingPool& pool, WorkStealingPool::TaskGroup& group, Work work)
+{
+    try {
+      work();
+    }
+    catch(...) {
+      try {
+        pool.wait(group);
+      }
+      catch(...) {
+      }
+      throw;
+    }
+    pool.wait(group);
+}
+
+// the top splitDepth levels fork: the left subtree goes to the pool
+template<typename Key, typename Value, typename Function>
+void forEachPart(Node<Key, Value>* n, int splitDepth, WorkStealingPool& pool, Function& fn)
+{
+    Node<Key, Value>* left = n->getLeft();
+    Node<Key, Value>* right = n->getRight();
+    if(splitDepth == 0 || !left || !right) {
+      visitSubtree(n, fn);
+      return;
+    }
+
+    WorkStealingPool::TaskGroup group;
+    pool.spawn(group, [&]() { forEachPart(left, splitDepth - 1, pool, fn); });
+    forkJoin(pool, group, [&]() {
+      fn(n->getItem());
+      forEachPart(right, splitDepth - 1, pool, fn);
+    });
+}
+
+template<typename Key, typename Value, typename T, typename Accumulate>
+T reduceSubtree(const Node<Key, Value>* n, const T& init, Accumulate& accumulate)
+{
+    T result(init);
+    auto visit = [&](const std::pair<const Key, Value>& item) { result = accumulate(std::move(result), item); };
+    visitSubtree(n, visit);
+    return result;
+}
+
+// returns the parts under n merged in key order: left, n, right
+template<typename Key, typename Value, typename T, typename Accumulate, typename Combine>
+T reduceOrdered(const Node<Key, Value>* n, int splitDepth, WorkStealingPool& pool, const T& init,
+                Accumulate& accumulate, Combine& combine)
+{
+    const Node<Key, Value>* left = n->getLeft();
+    const Node<Key, Value>* right = n->getRight();
+    if(splitDepth == 0 || !left || !right) return reduceSubtree(n, init, accumulate);
+
+    T leftResult(init);
+    T rightResult(init);
+    WorkStealingPool::TaskGroup group;
+    pool.spawn(group, [&]() { leftResult = reduceOrdered(left, splitDepth - 1, pool, init, accumulate, combine); });
+    forkJoin(pool, group, [&]() { rightResult = reduceOrdered(right, splitDepth - 1, pool, init, accumulate, combine); });
+    return combine(accumulate(std::move(leftResult), n->getItem()), std::move(rightResult));
+}
+
+// merges every part under n into total as soon as it is done
+template<typename Key, typename Value, typename T, typename Accumulate, typename Combine>
+void reduceUnordered(const Node<Key, Value>* n, int splitDepth, WorkStealingPool& pool, const T& init,
+                     Accumulate& accumulate, Combine& combine, T& total, std::mutex& totalLock)
+{
+    const Node<Key, Value>* left = n->getLeft();
+    const Node<Key, Value>* right = n->getRight();
+    if(splitDepth == 0 || !left || !right) {
+      T part = reduceSubtree(n, init, accumulate);
+      std::lock_guard<std::mutex> guard(totalLock);
+      total = combine(std::move(total), std::move(part));
+      return;
+    }
+
+    WorkStealingPool::TaskGroup group;
+    pool.spawn(group, [&]() { reduceUnordered(left, splitDepth - 1, pool, init, accumulate, combine, total, totalLock); });
+    forkJoin(pool, group, [&]() {
+      T part = accumulate(T(init), n->getItem());
+      {
+        std::lock_guard<std::mutex> guard(totalLock);
+        total = combine(std::move(total), std::move(part));
+      }
+      reduceUnordered(right, splitDepth - 1, pool, init, accumulate, combine, total, totalLock);
+    });
+}
+
+template<typename Key, typename Value, typename Compare, typename Function>
+void parallel_for_each(BinarySearchTree<Key, Value, Compare>& tree, Function fn)
+{
+    parallel_for_each(tree, fn, WorkStealingPool::shared());
+}
+
+template<typename Key, typename Value, typename Compare, typename Function>
+void parallel_for_each(BinarySearchTree<Key, Value, Compare>& tree, Function fn, WorkStealingPool& pool)
+{
+    if(tree.root_) forEachPart(tree.root_, pool.forkDepth(), pool, fn);
+}
+
+template<typename Key, typename Value, typename Compare, typename T, typename Accumulate, typename Combine>
+T parallel_reduce(const BinarySearchTree<Key, Value, Compare>& tree, T init, Accumulate accumulate,
+                  Combine combine, bool inOrder)
+{
+    return parallel_reduce(tree, init, accumulate, combine, WorkStealingPool::shared(), inOrder);
+}
+
+template<typename Key, typename Value, typename Compare, typename T, typename Accumulate, typename Combine>
+T parallel_reduce(const BinarySearchTree<Key, Value, Compare>& tree, T init, Accumulate accumulate,
+                  Combine combine, WorkStealingPool& pool, bool inOrder)
+{
+    const Node<Key, Value>* root = tree.rootNode();
+    if(!root) return init;
+    if(inOrder) return reduceOrdered(root, pool.forkDepth(), pool, init, accumulate, combine);
+
+    T total(init);
+    std::mutex totalLock;
+    reduceUnordered(root, pool.forkDepth(), pool, init, accumulate, combine, total, totalLock);
+    return total;
+}
+
+/*
+--------------------------------------------------
+End implementations for the parallel traversals.
+--------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <map>
+#include <cmath>
+#include "rbbst.h"
+#include "tree-check.h"
+
+using namespace std;
+
+typedef RedBlackTree<int,int> Tree;
+
+static bool valid(const Tree& tree)
+{
+    // the red-black rules bound the height by 2 log2(n + 1)
+    return tree.isBalanced() &&
+           subtreeHeight(tree.rootNode()) <= 2 * log2(tree.size() + 1.0);
+}
+
+static void testSortedRuns()
+{
+    Tree tree;
+    map<int,int> ref;
+    for(int i = 0; i < 5000; i++) {
+      tree.insert(make_pair(i, i));
+      ref[i] = i;
+    }
+    for(int i = 9999; i >= 5000; i--) {
+      tree.insert(make_pair(i, i));
+      ref[i] = i;
+    }
+    CHECK(valid(tree));
+    CHECK(sameItems(tree, ref));
+    for(int i = 0; i < 10000; i += 3) {
+      tree.remove(i);
+      ref.erase(i);
+    }
+    CHECK(valid(tree));
+    CHECK(sameItems(tree, ref));
+}
+
+static void testRandomChurn()
+{
+    for(unsigned seed = 1; seed <= 3; seed++) {
+      Tree tree;
+      map<int,int> ref;
+      churn(tree, ref, seed, 20000, 2000, valid);
+      churn(tree, ref, seed + 10, 5000, 40, valid);
+      // drain it completely; the last removals recolor the root
+      for(int key = 0; key < 2000; key++) {
+        tree.remove(key);
+        ref.erase(key);
+      }
+      CHECK(tree.empty() && valid(tree));
+    }
+}
+
+static void testRebalance()
+{
+    Tree tree;
+    map<int,int> ref;
+    churn(tree, ref, 5, 10000, 5000, valid);
+    tree.rebalance();
+    CHECK(valid(tree));
+    CHECK(sameItems(tree, ref));
+    churn(tree, ref, 6, 10000, 5000, valid);
+}
+
+int main()
+{
+    testSortedRuns();
+    testRandomChurn();
+    testRebalance();
+    return checkResult("rbbst-test");
+}
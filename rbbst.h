@@ -0,0 +1,477 @@
+#ifndef RBBST_H
+#define RBBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* A node for a Red-Black tree, which adds the color as a data member.
+*/
+template <typename Key, typename Value>
+class RBNode : public Node<Key, Value>
+{
+public:
+    enum Color { RED, BLACK };
+
+    // Constructor/destructor.  New nodes are red.
+    RBNode(const Key& key, const Value& value, RBNode<Key, Value>* parent);
+    virtual ~RBNode();
+    virtual RBNode<Key, Value>* clone() const override;
+
+    // Getter/setter for the node's color.
+    Color getColor() const;
+    void setColor(Color color);
+
+    // Getters for parent, left, and right, returning RBNodes.
+    virtual RBNode<Key, Value>* getParent() const override;
+    virtual RBNode<Key, Value>* getLeft() const override;
+    virtual RBNode<Key, Value>* getRight() const override;
+
+protected:
+    Color color_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the RBNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor to initialize the elements by calling the base class constructor
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::RBNode(const Key& key, const Value& value, RBNode<Key, Value> *parent) :
+    Node<Key, Value>(key, value, parent), color_(RED)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::~RBNode()
+{
+
+}
+
+template<class Key, class Value>
+RBNode<Key, Value>* RBNode<Key, Value>::clone() const
+{
+    return new RBNode<Key, Value>(*this);
+}
+
+/**
+* A getter for the color of a RBNode.
+*/
+template<class Key, class Value>
+typename RBNode<Key, Value>::Color RBNode<Key, Value>::getColor() const
+{
+    return color_;
+}
+
+/**
+* A setter for the color of a RBNode.
+*/
+template<class Key, class Value>
+void RBNode<Key, Value>::setColor(Color color)
+{
+    color_ = color;
+}
+
+/**
+* An overridden function for getting the parent since a static_cast is necessary to make sure
+* that our node is a RBNode.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getParent() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->parent_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getLeft() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getRight() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RBNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A Red-Black tree.  Compared to AVLTree it keeps a looser height bound
+* (2 log n), in exchange for at most two rotations per insert and three
+* per remove, which suits workloads that churn keys.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class RedBlackTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    virtual void insert (const std::pair<const Key, Value> &keyValuePair);
+    virtual void remove(const Key& key);
+    using BinarySearchTree<Key, Value, Compare>::insert;
+    virtual void rebalance();
+    virtual bool isBalanced() const override;
+protected:
+    virtual void nodeSwap( RBNode<Key,Value>* n1, RBNode<Key,Value>* n2);
+    void linkLeaf(RBNode<Key,Value>* parent, bool left, RBNode<Key,Value>* n);
+    virtual Node<Key,Value>* detachNode(Node<Key,Value>* n);
+    virtual Node<Key,Value>* attachNode(Node<Key,Value>* n);
+    virtual void eraseRange(Node<Key,Value>* first, Node<Key,Value>* last);
+    virtual bool isCompatibleNode(const Node<Key,Value>* n) const;
+    virtual void insertFix(RBNode<Key,Value>* n);
+    virtual void removeFix(RBNode<Key,Value>* n);
+    static bool isRed(RBNode<Key,Value>* n);
+    static int blackHeight(RBNode<Key,Value>* n);
+    static void colorByDepth(RBNode<Key,Value>* n, int depth, int redDepth);
+};
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &keyValuePair)
+{
+    RBNode<Key, Value>* current = static_cast<RBNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_);
+    RBNode<Key, Value>* parent = nullptr;
+
+    int c = 0;
+    KeyProbe<Key, Compare, Key> probe(this->comp_, keyValuePair.first);
+    while(current && (c = probe.compare(current)) != 0) {
+      parent = current;
+      if(c < 0)
+        current = current->getLeft();
+      else
+        current = current->getRight();
+    }
+
+    // key is already in the tree, just update the value
+    if(current) {
+      current->setValue(keyValuePair.second);
+      return;
+    }
+
+    linkLeaf(parent, c < 0, new RBNode<Key, Value>(keyValuePair.first, keyValuePair.second, parent));
+}
+
+// links the childless node n in below parent as a red leaf and fixes the colors
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::linkLeaf(RBNode<Key,Value>* parent, bool left, RBNode<Key,Value>* n)
+{
+    n->setParent(parent);
+    n->setColor(RBNode<Key,Value>::RED);
+    if(!parent) BinarySearchTree<Key, Value, Compare>::root_ = n;
+    else if(left)
+      parent->setLeft(n);
+    else
+      parent->setRight(n);
+    this->leafLinked(n);
+
+    insertFix(n);
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value (and free n).
+ */
+template<class Key, class Value, class Compare>
+Node<Key,Value>* RedBlackTree<Key, Value, Compare>::attachNode(Node<Key,Value>* n)
+{
+    Node<Key,Value>* parent;
+    int c;
+    Node<Key,Value>* current = this->descend(n->getKey(), parent, c);
+
+    if(current) {
+      current->setValue(n->getValue());
+      delete n;
+      return current;
+    }
+    linkLeaf(static_cast<RBNode<Key,Value>*>(parent), c < 0, static_cast<RBNode<Key,Value>*>(n));
+    return n;
+}
+
+template<class Key, class Value, class Compare>
+bool RedBlackTree<Key, Value, Compare>::isCompatibleNode(const Node<Key,Value>* n) const
+{
+    return dynamic_cast<const RBNode<Key,Value>*>(n) != NULL;
+}
+
+/**
+* Rebuilds the tree with BinarySearchTree::rebalance and recolors it.  Every
+* level of the rebuilt tree is full except possibly the deepest, so coloring
+* that level red and the rest black gives every path the same black height.
+*/
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::rebalance()
+{
+    BinarySearchTree<Key, Value, Compare>::rebalance();
+
+    size_t n = this->count_;
+    int deepest = 0;
+    while(((size_t)2 << deepest) <= n) deepest++;
+    bool perfect = n + 1 == ((size_t)2 << deepest);
+    colorByDepth(static_cast<RBNode<Key,Value>*>(this->root_), 0, perfect ? -1 : deepest);
+}
+
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::colorByDepth(RBNode<Key,Value>* n, int depth, int redDepth)
+{
+    if(!n) return;
+    n->setColor(depth == redDepth ? RBNode<Key,Value>::RED : RBNode<Key,Value>::BLACK);
+    colorByDepth(n->getLeft(), depth + 1, redDepth);
+    colorByDepth(n->getRight(), depth + 1, redDepth);
+}
+
+// restores the red-black properties after n was linked in as a red leaf
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::insertFix(RBNode<Key,Value>* n) {
+
+  while(isRed(n->getParent())) {
+    RBNode<Key,Value>* p = n->getParent();
+    // a red parent is never the root, so g exists
+    RBNode<Key,Value>* g = p->getParent();
+
+    // CASE 1: P is LEFT child of g
+    if(g->getLeft() == p) {
+      RBNode<Key,Value>* u = g->getRight();
+      // CASE 1A: red uncle, recolor and continue from g
+      if(isRed(u)) {
+        p->setColor(RBNode<Key,Value>::BLACK);
+        u->setColor(RBNode<Key,Value>::BLACK);
+        g->setColor(RBNode<Key,Value>::RED);
+        n = g;
+        continue;
+      }
+      // CASE 1B: ZIG-ZAG, rotate into the zig-zig shape
+      if(p->getRight() == n) {
+        this->rotateLeft(p);
+        n = p;
+        p = n->getParent();
+      }
+      // CASE 1C: ZIG-ZIG
+      p->setColor(RBNode<Key,Value>::BLACK);
+      g->setColor(RBNode<Key,Value>::RED);
+      this->rotateRight(g);
+    }
+
+    // CASE 2: P is RIGHT child of g
+    else {
+      RBNode<Key,Value>* u = g->getLeft();
+      // CASE 2A: red uncle, recolor and continue from g
+      if(isRed(u)) {
+        p->setColor(RBNode<Key,Value>::BLACK);
+        u->setColor(RBNode<Key,Value>::BLACK);
+        g->setColor(RBNode<Key,Value>::RED);
+        n = g;
+        continue;
+      }
+      // CASE 2B: ZIG-ZAG, rotate into the zig-zig shape
+      if(p->getLeft() == n) {
+        this->rotateRight(p);
+        n = p;
+        p = n->getParent();
+      }
+      // CASE 2C: ZIG-ZIG
+      p->setColor(RBNode<Key,Value>::BLACK);
+      g->setColor(RBNode<Key,Value>::RED);
+      this->rotateLeft(g);
+    }
+  }
+
+  static_cast<RBNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_)->setColor(RBNode<Key,Value>::BLACK);
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::remove(const Key& key)
+{
+    Node<Key,Value>* current = this->internalFind(key);
+
+    // CASE 1: There is no node with the desired key to be removed
+    if(!current) return;
+
+    delete detachNode(current);
+}
+
+// unlinks n and fixes the colors without freeing it
+template<class Key, class Value, class Compare>
+Node<Key,Value>* RedBlackTree<Key, Value, Compare>::detachNode(Node<Key,Value>* n)
+{
+    RBNode<Key,Value>* current = static_cast<RBNode<Key,Value>*>(n);
+    this->nodeLeaving(current);
+
+    // CASE 2: 2 Children (Swaps current with predecessor)
+    if(current->getLeft() && current->getRight()) {
+      nodeSwap(current, static_cast<RBNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::predecessor(current)));
+    }
+
+    // Node now has 0-1 children
+    RBNode<Key,Value>* child = current->getLeft() ? current->getLeft() : current->getRight();
+
+    // a black leaf leaves a missing black on its path; fix it while the
+    // node is still linked so it can stand in for the empty subtree
+    if(!isRed(current) && !isRed(child)) removeFix(current);
+    // a red child takes over the black of the removed node
+    else if(child && !isRed(current)) child->setColor(RBNode<Key,Value>::BLACK);
+
+    RBNode<Key,Value>* parent = current->getParent();
+    if(child) child->setParent(parent);
+    if(!parent)
+      BinarySearchTree<Key, Value, Compare>::root_ = child;
+    else if(parent->getLeft() == current)
+      parent->setLeft(child);
+    else
+      parent->setRight(child);
+
+    return current;
+}
+
+// n carries an extra black; push it up or absorb it with rotations
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::removeFix(RBNode<Key,Value>* n) {
+
+  while(n != BinarySearchTree<Key, Value, Compare>::root_ && !isRed(n)) {
+    RBNode<Key,Value>* p = n->getParent();
+
+    // CASE 1: N is LEFT child of p
+    if(p->getLeft() == n) {
+      // the sibling subtree has black height >= 1, so it exists
+      RBNode<Key,Value>* s = p->getRight();
+      // CASE 1A: red sibling, rotate so the sibling is black
+      if(isRed(s)) {
+        s->setColor(RBNode<Key,Value>::BLACK);
+        p->setColor(RBNode<Key,Value>::RED);
+        this->rotateLeft(p);
+        s = p->getRight();
+      }
+      // CASE 1B: black sibling with black children, push the black up
+      if(!isRed(s->getLeft()) && !isRed(s->getRight())) {
+        s->setColor(RBNode<Key,Value>::RED);
+        n = p;
+        continue;
+      }
+      // CASE 1C: near nephew red, rotate it into the far position
+      if(!isRed(s->getRight())) {
+        s->getLeft()->setColor(RBNode<Key,Value>::BLACK);
+        s->setColor(RBNode<Key,Value>::RED);
+        this->rotateRight(s);
+        s = p->getRight();
+      }
+      // CASE 1D: far nephew red, one rotation absorbs the extra black
+      s->setColor(p->getColor());
+      p->setColor(RBNode<Key,Value>::BLACK);
+      s->getRight()->setColor(RBNode<Key,Value>::BLACK);
+      this->rotateLeft(p);
+      return;
+    }
+
+    // CASE 2: N is RIGHT child of p
+    else {
+      RBNode<Key,Value>* s = p->getLeft();
+      // CASE 2A: red sibling, rotate so the sibling is black
+      if(isRed(s)) {
+        s->setColor(RBNode<Key,Value>::BLACK);
+        p->setColor(RBNode<Key,Value>::RED);
+        this->rotateRight(p);
+        s = p->getLeft();
+      }
+      // CASE 2B: black sibling with black children, push the black up
+      if(!isRed(s->getLeft()) && !isRed(s->getRight())) {
+        s->setColor(RBNode<Key,Value>::RED);
+        n = p;
+        continue;
+      }
+      // CASE 2C: near nephew red, rotate it into the far position
+      if(!isRed(s->getLeft())) {
+        s->getRight()->setColor(RBNode<Key,Value>::BLACK);
+        s->setColor(RBNode<Key,Value>::RED);
+        this->rotateLeft(s);
+        s = p->getLeft();
+      }
+      // CASE 2D: far nephew red, one rotation absorbs the extra black
+      s->setColor(p->getColor());
+      p->setColor(RBNode<Key,Value>::BLACK);
+      s->getLeft()->setColor(RBNode<Key,Value>::BLACK);
+      this->rotateRight(p);
+      return;
+    }
+  }
+
+  n->setColor(RBNode<Key,Value>::BLACK);
+}
+
+// empty subtrees count as black
+template<class Key, class Value, class Compare>
+bool RedBlackTree<Key, Value, Compare>::isRed(RBNode<Key,Value>* n) {
+  return n && n->getColor() == RBNode<Key,Value>::RED;
+}
+
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::nodeSwap( RBNode<Key,Value>* n1, RBNode<Key,Value>* n2)
+{
+    BinarySearchTree<Key, Value, Compare>::nodeSwap(n1, n2);
+    typename RBNode<Key,Value>::Color tempC = n1->getColor();
+    n1->setColor(n2->getColor());
+    n2->setColor(tempC);
+}
+
+/**
+* The red-black rules rather than the AVL height bound, which a valid
+* red-black tree may exceed: a black root, no red node with a red child and
+* the same number of black nodes on every path.
+*/
+template<class Key, class Value, class Compare>
+bool RedBlackTree<Key, Value, Compare>::isBalanced() const
+{
+    RBNode<Key,Value>* root = static_cast<RBNode<Key,Value>*>(BinarySearchTree<Key, Value, Compare>::root_);
+    return !isRed(root) && blackHeight(root) > 0;
+}
+
+// the black height of the subtree (counting the NULL leaves), or -1 if a
+// rule is broken inside it
+template<class Key, class Value, class Compare>
+int RedBlackTree<Key, Value, Compare>::blackHeight(RBNode<Key,Value>* n) {
+  if(!n) return 1;
+  if(isRed(n) && (isRed(n->getLeft()) || isRed(n->getRight()))) return -1;
+  int left = blackHeight(n->getLeft());
+  int right = blackHeight(n->getRight());
+  if(left < 0 || left != right) return -1;
+  return left + (isRed(n) ? 0 : 1);
+}
+
+// removes the items one at a time, since split and join would not keep the colors
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::eraseRange(Node<Key,Value>* first, Node<Key,Value>* last)
+{
+    while(first != last) {
+      Node<Key,Value>* next = BinarySearchTree<Key, Value, Compare>::successor(first);
+      delete detachNode(first);
+      first = next;
+    }
+}
+
+#endif
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <map>
+#include <cmath>
+#include "scapegoatbst.h"
+#include "tree-check.h"
+
+using namespace std;
+
+typedef ScapegoatTree<int,int> Tree;
+
+// The height stays within log_{1/alpha}(maxSize) + 1, and removals rebuild
+// before the size falls below alpha * maxSize, so in terms of the size it is
+// at most log_{1/alpha}(size) + 2.
+static bool valid(const Tree& tree)
+{
+    if(!isSearchTree(tree)) return false;
+    if(tree.empty()) return true;
+    double bound = log((double)tree.size()) / log(1.0 / tree.getAlpha()) + 2;
+    return subtreeHeight(tree.rootNode()) <= bound;
+}
+
+static void testRandomChurn()
+{
+    double alphas[] = { 0.55, 0.7, 0.95 };
+    for(int a = 0; a < 3; a++) {
+      Tree tree(alphas[a]);
+      map<int,int> ref;
+      churn(tree, ref, 1 + a, 20000, 2000, valid);
+      churn(tree, ref, 11 + a, 5000, 40, valid);
+    }
+}
+
+static void testSortedRuns()
+{
+    Tree tree;
+    map<int,int> ref;
+    for(int i = 0; i < 10000; i++) {
+      tree.insert(make_pair(i, i));
+      ref[i] = i;
+      if(i % 1000 == 0) CHECK(valid(tree));
+    }
+    CHECK(sameItems(tree, ref));
+    // shrinking must trigger the full rebuilds
+    for(int i = 0; i < 9900; i++) {
+      tree.remove(i);
+      ref.erase(i);
+      if(i % 1000 == 0) CHECK(valid(tree));
+    }
+    CHECK(valid(tree));
+    CHECK(sameItems(tree, ref));
+}
+
+static void testClearAndSwap()
+{
+    CHECK(Tree(0.1).getAlpha() == 0.55);
+    CHECK(Tree(2.0).getAlpha() == 0.95);
+
+    Tree tree;
+    map<int,int> ref;
+    for(int i = 0; i < 5000; i++) tree.insert(make_pair(i, i));
+    tree.clear();
+    CHECK(tree.size() == 0 && tree.empty());
+    // the cleared tree starts over: a few inserts and removes stay valid
+    for(int i = 0; i < 10; i++) {
+      tree.insert(make_pair(i, i));
+      ref[i] = i;
+    }
+    tree.remove(3);
+    ref.erase(3);
+    CHECK(valid(tree));
+    CHECK(sameItems(tree, ref));
+
+    Tree other(0.6);
+    map<int,int> otherRef;
+    for(int i = 100; i < 200; i++) {
+      other.insert(make_pair(i, -i));
+      otherRef[i] = -i;
+    }
+    tree.swap(other);
+    CHECK(tree.getAlpha() == 0.6 && other.getAlpha() == 0.7);
+    CHECK(sameItems(tree, otherRef) && sameItems(other, ref));
+    churn(tree, otherRef, 3, 2000, 300, valid);
+    churn(other, ref, 4, 2000, 300, valid);
+}
+
+int main()
+{
+    testRandomChurn();
+    testSortedRuns();
+    testClearAndSwap();
+    return checkResult("scapegoatbst-test");
+}
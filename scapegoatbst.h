@@ -0,0 +1,308 @@
+#ifndef SCAPEGOATBST_H
+#define SCAPEGOATBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* A scapegoat tree.  Nodes are plain Nodes with no balance data at all; the
+* tree only tracks the largest size since the last full rebuild.
+*
+* An insert that lands deeper than log_{1/alpha}(size) walks back up to the
+* first ancestor whose child subtree holds more than alpha of its nodes (the
+* scapegoat) and rebuilds that subtree perfectly balanced in linear time.
+* When removals shrink the tree below alpha * maxSize the whole tree is
+* rebuilt.  Updates cost O(log n) amortized and the height stays below
+* log_{1/alpha}(n) + 1.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class ScapegoatTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    // alpha is clamped to [0.55, 0.95]; smaller means flatter but more rebuilds
+    ScapegoatTree(double alpha = 0.7);
+    void swap(ScapegoatTree& other);
+    using BinarySearchTree<Key, Value, Compare>::insert;
+    virtual void insert (const std::pair<const Key, Value> &keyValuePair);
+    virtual void remove(const Key& key);
+    virtual void rebalance();
+    double getAlpha() const;
+
+protected:
+    int depthLimit(size_t n) const;
+    void linkLeaf(Node<Key, Value>* parent, bool left, Node<Key, Value>* current, int depth);
+    virtual Node<Key, Value>* detachNode(Node<Key, Value>* n);
+    virtual Node<Key, Value>* attachNode(Node<Key, Value>* n);
+    virtual void eraseRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    virtual void cleared();
+    static size_t subtreeSize(Node<Key, Value>* n);
+    void rebuild(Node<Key, Value>* n, size_t count);
+    static Node<Key, Value>* buildBalanced(std::vector<Node<Key, Value>*>& nodes,
+                                           size_t lo, size_t hi, Node<Key, Value>* parent);
+
+    double alpha_;
+    // the largest size since the last full rebuild; a moved-from tree keeps
+    // its old value, which at worst brings the next full rebuild forward
+    size_t maxSize_;
+};
+
+/*
+---------------------------------------------------
+Begin implementations for the ScapegoatTree class.
+---------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+ScapegoatTree<Key, Value, Compare>::ScapegoatTree(double alpha) :
+    alpha_(std::min(0.95, std::max(0.55, alpha))),
+    maxSize_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+void ScapegoatTree<Key, Value, Compare>::swap(ScapegoatTree& other)
+{
+    BinarySearchTree<Key, Value, Compare>::swap(other);
+    std::swap(alpha_, other.alpha_);
+    std::swap(maxSize_, other.maxSize_);
+}
+
+template<class Key, class Value, class Compare>
+double ScapegoatTree<Key, Value, Compare>::getAlpha() const
+{
+    return alpha_;
+}
+
+/**
+* clear() empties the tree through the base class, so the deletion
+* allowance starts over here.
+*/
+template<class Key, class Value, class Compare>
+void ScapegoatTree<Key, Value, Compare>::cleared()
+{
+    maxSize_ = 0;
+}
+
+/**
+* A whole-tree rebuild, like the one a scapegoat at the root triggers, so the
+* deletion allowance starts over as well.
+*/
+template<class Key, class Value, class Compare>
+void ScapegoatTree<Key, Value, Compare>::rebalance()
+{
+    BinarySearchTree<Key, Value, Compare>::rebalance();
+    maxSize_ = this->count_;
+}
+
+// floor(log_{1/alpha}(n)): the deepest an insert may land without a rebuild
+template<class Key, class Value, class Compare>
+int ScapegoatTree<Key, Value, Compare>::depthLimit(size_t n) const
+{
+    return (int)std::floor(std::log((double)n) / std::log(1.0 / alpha_));
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value, class Compare>
+void ScapegoatTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &keyValuePair)
+{
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* parent = nullptr;
+    int depth = 0;
+
+    int c = 0;
+    KeyProbe<Key, Compare, Key> probe(this->comp_, keyValuePair.first);
+    while(current && (c = probe.compare(current)) != 0) {
+      parent = current;
+      depth++;
+      if(c < 0)
+        current = current->getLeft();
+      else
+        current = current->getRight();
+    }
+
+    // CASE 1: key is already in the tree, just update the value
+    if(current) {
+      current->setValue(keyValuePair.second);
+      return;
+    }
+
+    // CASE 2: link in a new leaf
+    linkLeaf(parent, c < 0, new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent), depth);
+}
+
+/**
+* Links the childless node current in below parent at the given depth (the
+* root has depth 0), then rebuilds at a scapegoat if the leaf is too deep.
+*/
+template<class Key, class Value, class Compare>
+void ScapegoatTree<Key, Value, Compare>::linkLeaf(Node<Key, Value>* parent, bool left,
+                                                  Node<Key, Value>* current, int depth)
+{
+    current->setParent(parent);
+    if(!parent) this->root_ = current;
+    else if(left)
+      parent->setLeft(current);
+    else
+      parent->setRight(current);
+    this->leafLinked(current);
+
+    maxSize_ = std::max(maxSize_, this->count_);
+    if(depth <= depthLimit(this->count_)) return;
+
+    // CASE 3: too deep; climb until a child holds more than alpha of its
+    // parent's subtree.  Only the sibling subtrees are counted, so the
+    // climb costs no more than the rebuild that follows.
+    size_t childSize = 1;
+    Node<Key, Value>* child = current;
+    Node<Key, Value>* goat = current->getParent();
+    while(goat) {
+      Node<Key, Value>* sibling = (goat->getLeft() == child) ? goat->getRight() : goat->getLeft();
+      size_t goatSize = 1 + childSize + subtreeSize(sibling);
+      if((double)childSize > alpha_ * goatSize) {
+        rebuild(goat, goatSize);
+        return;
+      }
+      child = goat;
+      childSize = goatSize;
+      goat = goat->getParent();
+    }
+}
+
+/*
+ * Removal reuses the BinarySearchTree unlink (predecessor swap and splice).
+ */
+template<class Key, class Value, class Compare>
+void ScapegoatTree<Key, Value, Compare>::remove(const Key& key)
+{
+    Node<Key, Value>* current = this->internalFind(key);
+    if(!current) return;
+
+    delete detachNode(current);
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>* ScapegoatTree<Key, Value, Compare>::detachNode(Node<Key, Value>* n)
+{
+    Node<Key, Value>* current = this->unlinkNode(n);
+
+    // CASE: too many removals since the last rebuild, rebuild everything
+    if((double)this->count_ < alpha_ * maxSize_) {
+      if(this->root_) rebuild(this->root_, this->count_);
+      maxSize_ = this->count_;
+    }
+    return current;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value (and free n).
+ */
+template<class Key, class Value, class Compare>
+Node<Key, Value>* ScapegoatTree<Key, Value, Compare>::attachNode(Node<Key, Value>* n)
+{
+    Node<Key, Value>* parent;
+    int c;
+    Node<Key, Value>* current = this->descend(n->getKey(), parent, c);
+
+    if(current) {
+      current->setValue(n->getValue());
+      delete n;
+      return current;
+    }
+
+    int depth = 0;
+    for(Node<Key, Value>* p = parent; p; p = p->getParent()) depth++;
+    linkLeaf(parent, c < 0, n, depth);
+    return n;
+}
+
+// counts a subtree's nodes with an explicit stack
+template<class Key, class Value, class Compare>
+size_t ScapegoatTree<Key, Value, Compare>::subtreeSize(Node<Key, Value>* n)
+{
+    size_t count = 0;
+    std::vector<Node<Key, Value>*> stack;
+    if(n) stack.push_back(n);
+    while(!stack.empty()) {
+      Node<Key, Value>* top = stack.back();
+      stack.pop_back();
+      count++;
+      if(top->getLeft()) stack.push_back(top->getLeft());
+      if(top->getRight()) stack.push_back(top->getRight());
+    }
+    return count;
+}
+
+/**
+* Rebuilds the subtree rooted at n (holding count nodes) into a perfectly
+* balanced shape.  The existing nodes are relinked, not reallocated.
+*/
+template<class Key, class Value, class Compare>
+void ScapegoatTree<Key, Value, Compare>::rebuild(Node<Key, Value>* n, size_t count)
+{
+    Node<Key, Value>* parent = n->getParent();
+    bool wasLeft = parent && parent->getLeft() == n;
+
+    // flatten in order
+    std::vector<Node<Key, Value>*> nodes;
+    nodes.reserve(count);
+    Node<Key, Value>* current = n;
+    std::vector<Node<Key, Value>*> stack;
+    while(current || !stack.empty()) {
+      while(current) {
+        stack.push_back(current);
+        current = current->getLeft();
+      }
+      current = stack.back();
+      stack.pop_back();
+      nodes.push_back(current);
+      current = current->getRight();
+    }
+
+    Node<Key, Value>* top = buildBalanced(nodes, 0, nodes.size(), parent);
+    if(!parent) this->root_ = top;
+    else if(wasLeft) parent->setLeft(top);
+    else parent->setRight(top);
+}
+
+// links nodes[lo, hi) into a balanced subtree under parent and returns its root
+template<class Key, class Value, class Compare>
+Node<Key, Value>* ScapegoatTree<Key, Value, Compare>::buildBalanced(std::vector<Node<Key, Value>*>& nodes,
+                                                           size_t lo, size_t hi, Node<Key, Value>* parent)
+{
+    if(lo >= hi) return nullptr;
+    size_t mid = lo + (hi - lo) / 2;
+    Node<Key, Value>* n = nodes[mid];
+    n->setParent(parent);
+    n->setLeft(buildBalanced(nodes, lo, mid, n));
+    n->setRight(buildBalanced(nodes, mid + 1, hi, n));
+    return n;
+}
+
+// removes the items one at a time so the size bookkeeping and rebuilds apply
+template<class Key, class Value, class Compare>
+void ScapegoatTree<Key, Value, Compare>::eraseRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    while(first != last) {
+      Node<Key, Value>* next = BinarySearchTree<Key, Value, Compare>::successor(first);
+      delete detachNode(first);
+      first = next;
+    }
+}
+
+/*
+-------------------------------------------------
+End implementations for the ScapegoatTree class.
+-------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <map>
+#include "splaybst.h"
+#include "tree-check.h"
+
+using namespace std;
+
+typedef SplayTree<int,int> Tree;
+
+static bool valid(const Tree& tree)
+{
+    return isSearchTree(tree);
+}
+
+static void testRandomChurn()
+{
+    SplayMode modes[] = { FULL_SPLAY, SEMI_SPLAY };
+    for(int m = 0; m < 2; m++) {
+      for(unsigned period = 1; period <= 4; period += 3) {
+        Tree tree(modes[m], period);
+        map<int,int> ref;
+        churn(tree, ref, 1 + m + period, 20000, 2000, valid);
+        churn(tree, ref, 11 + m + period, 5000, 40, valid);
+      }
+    }
+}
+
+// sorted inserts leave a list-shaped tree; lookups must still work on it
+static void testSortedRun()
+{
+    Tree tree;
+    map<int,int> ref;
+    for(int i = 0; i < 10000; i++) {
+      tree.insert(make_pair(i, i));
+      ref[i] = i;
+    }
+    CHECK(valid(tree));
+    CHECK(sameItems(tree, ref));
+    for(int i = 0; i < 10000; i += 7) CHECK(tree[i] == i);
+    CHECK(valid(tree));
+    CHECK(sameLookups(tree, ref, 10000));
+}
+
+static void testSplaying()
+{
+    Tree tree(FULL_SPLAY, 1);
+    for(int i = 0; i < 1000; i++) tree.insert(make_pair((i * 37) % 1000, i));
+    // writes always splay the key to the root
+    tree.insert(make_pair(500, 0));
+    CHECK(tree.rootNode()->getKey() == 500);
+    // so do non-const lookups with a splay period of 1
+    tree.find(123);
+    CHECK(tree.rootNode()->getKey() == 123);
+    tree[321] = 5;
+    CHECK(tree.rootNode()->getKey() == 321);
+    // lookups through a const tree never restructure it
+    const Tree& constTree = tree;
+    CHECK(constTree.find(777)->first == 777);
+    CHECK(tree.rootNode()->getKey() == 321);
+
+    // with a period of 4 only every fourth lookup splays
+    tree.setSplayPeriod(4);
+    int splayed = 0;
+    for(int i = 0; i < 8; i++) {
+      tree.find(10 + i);
+      if(tree.rootNode()->getKey() == 10 + i) splayed++;
+    }
+    CHECK(splayed == 2);
+    CHECK(valid(tree));
+}
+
+int main()
+{
+    testRandomChurn();
+    testSortedRun();
+    testSplaying();
+    return checkResult("splaybst-test");
+}
@@ -0,0 +1,341 @@
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* How far an accessed node is moved towards the root.
+*   FULL_SPLAY: all the way to the root (classic bottom-up splaying).
+*   SEMI_SPLAY: zig-zig steps lift the parent instead of the node, which
+*               roughly halves the access path with about half the rotations.
+*/
+enum SplayMode { FULL_SPLAY, SEMI_SPLAY };
+
+/**
+* A self-adjusting search tree.  Accessed keys are splayed towards the root so
+* that hot keys sit near the top.  Splay trees need no per-node metadata, so
+* plain Nodes are used.
+*
+* Writes (insert/remove) always splay.  Reads (find/operator[]) splay only on
+* every splayPeriod-th call, which bounds the rotations (and the writes they
+* cause) on read-mostly workloads while hot keys still drift upwards.
+* Lookups through a const tree never restructure it.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class SplayTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    SplayTree(SplayMode mode = FULL_SPLAY, unsigned splayPeriod = 1);
+    virtual void insert (const std::pair<const Key, Value> &keyValuePair);
+    virtual void remove(const Key& key);
+    void swap(SplayTree& other);
+    using BinarySearchTree<Key, Value, Compare>::insert;
+
+    // non-const lookups splay; the const versions from the base do not
+    using BinarySearchTree<Key, Value, Compare>::find;
+    using BinarySearchTree<Key, Value, Compare>::operator[];
+    typename BinarySearchTree<Key, Value, Compare>::iterator find(const Key& key);
+    Value& operator[](const Key& key);
+
+    void setSplayMode(SplayMode mode);
+    void setSplayPeriod(unsigned splayPeriod);
+    SplayMode getSplayMode() const;
+    unsigned getSplayPeriod() const;
+
+protected:
+    Node<Key, Value>* accessNode(const Key& key);
+    virtual Node<Key, Value>* detachNode(Node<Key, Value>* n);
+    virtual Node<Key, Value>* attachNode(Node<Key, Value>* n);
+    virtual void eraseRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    virtual void splay(Node<Key, Value>* n);
+    void rotateUp(Node<Key, Value>* n);
+
+    SplayMode mode_;
+    unsigned splayPeriod_;
+    unsigned accessCount_;
+};
+
+/*
+-----------------------------------------------
+Begin implementations for the SplayTree class.
+-----------------------------------------------
+*/
+
+/**
+* Constructor; a splayPeriod of 0 is treated as 1 (splay on every read).
+*/
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree(SplayMode mode, unsigned splayPeriod) :
+    mode_(mode),
+    splayPeriod_(splayPeriod ? splayPeriod : 1),
+    accessCount_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::swap(SplayTree& other)
+{
+    BinarySearchTree<Key, Value, Compare>::swap(other);
+    std::swap(mode_, other.mode_);
+    std::swap(splayPeriod_, other.splayPeriod_);
+    std::swap(accessCount_, other.accessCount_);
+}
+
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::setSplayMode(SplayMode mode)
+{
+    mode_ = mode;
+}
+
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::setSplayPeriod(unsigned splayPeriod)
+{
+    splayPeriod_ = splayPeriod ? splayPeriod : 1;
+    accessCount_ = 0;
+}
+
+template<class Key, class Value, class Compare>
+SplayMode SplayTree<Key, Value, Compare>::getSplayMode() const
+{
+    return mode_;
+}
+
+template<class Key, class Value, class Compare>
+unsigned SplayTree<Key, Value, Compare>::getSplayPeriod() const
+{
+    return splayPeriod_;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ * Either way the node is splayed.
+ */
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &keyValuePair)
+{
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* parent = nullptr;
+
+    int c = 0;
+    KeyProbe<Key, Compare, Key> probe(this->comp_, keyValuePair.first);
+    while(current && (c = probe.compare(current)) != 0) {
+      parent = current;
+      if(c < 0)
+        current = current->getLeft();
+      else
+        current = current->getRight();
+    }
+
+    // CASE 1: key is already in the tree, just update the value
+    if(current) {
+      current->setValue(keyValuePair.second);
+    }
+    // CASE 2: link in a new leaf
+    else {
+      current = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent);
+      if(!parent) this->root_ = current;
+      else if(c < 0)
+        parent->setLeft(current);
+      else
+        parent->setRight(current);
+      this->leafLinked(current);
+    }
+
+    splay(current);
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.  The removed node's
+ * parent is splayed afterwards, which keeps the amortized bounds.
+ */
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::remove(const Key& key)
+{
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* last = nullptr;
+    int c;
+    KeyProbe<Key, Compare, Key> probe(this->comp_, key);
+    while(current && (c = probe.compare(current)) != 0) {
+      last = current;
+      if(c < 0)
+        current = current->getLeft();
+      else
+        current = current->getRight();
+    }
+
+    // CASE 1: key not found, splay the last node on the search path
+    if(!current) {
+      if(last) splay(last);
+      return;
+    }
+
+    delete detachNode(current);
+}
+
+// unlinks n without freeing it and splays its parent
+template<class Key, class Value, class Compare>
+Node<Key, Value>* SplayTree<Key, Value, Compare>::detachNode(Node<Key, Value>* current)
+{
+    this->nodeLeaving(current);
+
+    // CASE 2: 2 Children (Swaps current with predecessor)
+    if(current->getLeft() && current->getRight()) {
+      this->nodeSwap(current, BinarySearchTree<Key, Value, Compare>::predecessor(current));
+    }
+
+    // Node now has 0-1 children
+    Node<Key, Value>* child = current->getLeft() ? current->getLeft() : current->getRight();
+    Node<Key, Value>* parent = current->getParent();
+    if(child) child->setParent(parent);
+    if(!parent)
+      this->root_ = child;
+    else if(parent->getLeft() == current)
+      parent->setLeft(child);
+    else
+      parent->setRight(child);
+
+    if(parent) splay(parent);
+    return current;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value (and free n).
+ * Either way the node holding the key is splayed.
+ */
+template<class Key, class Value, class Compare>
+Node<Key, Value>* SplayTree<Key, Value, Compare>::attachNode(Node<Key, Value>* n)
+{
+    Node<Key, Value>* parent;
+    int c;
+    Node<Key, Value>* current = this->descend(n->getKey(), parent, c);
+
+    if(current) {
+      current->setValue(n->getValue());
+      delete n;
+    }
+    else {
+      current = n;
+      current->setParent(parent);
+      if(!parent) this->root_ = current;
+      else if(c < 0)
+        parent->setLeft(current);
+      else
+        parent->setRight(current);
+      this->leafLinked(current);
+    }
+
+    splay(current);
+    return current;
+}
+
+/**
+* Returns an iterator to the item with the given key, or end().  Counts as
+* an access for the splay period.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+SplayTree<Key, Value, Compare>::find(const Key& key)
+{
+    return this->makeIterator(accessNode(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key, splaying it as for find().
+ */
+template<class Key, class Value, class Compare>
+Value& SplayTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    Node<Key, Value>* curr = accessNode(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+// Looks up key and, on every splayPeriod-th access, splays the node found
+// (or the last node visited on a miss).
+template<class Key, class Value, class Compare>
+Node<Key, Value>* SplayTree<Key, Value, Compare>::accessNode(const Key& key)
+{
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* last = nullptr;
+    int c;
+    KeyProbe<Key, Compare, Key> probe(this->comp_, key);
+    while(current && (c = probe.compare(current)) != 0) {
+      last = current;
+      if(c < 0)
+        current = current->getLeft();
+      else
+        current = current->getRight();
+    }
+
+    if(++accessCount_ >= splayPeriod_) {
+      accessCount_ = 0;
+      splay(current ? current : last);
+    }
+    return current;
+}
+
+// Rotates n above its parent.
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::rotateUp(Node<Key, Value>* n)
+{
+    Node<Key, Value>* p = n->getParent();
+    if(p->getLeft() == n) this->rotateRight(p);
+    else this->rotateLeft(p);
+}
+
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::splay(Node<Key, Value>* n)
+{
+    if(!n) return;
+
+    while(n->getParent()) {
+      Node<Key, Value>* p = n->getParent();
+      Node<Key, Value>* g = p->getParent();
+
+      // CASE 1: ZIG, parent is the root
+      if(!g) {
+        rotateUp(n);
+      }
+      // CASE 2: ZIG-ZIG, n and p are on the same side
+      else if((g->getLeft() == p) == (p->getLeft() == n)) {
+        rotateUp(p);
+        // semi-splaying stops lifting n here and continues from p
+        if(mode_ == SEMI_SPLAY) n = p;
+        else rotateUp(n);
+      }
+      // CASE 3: ZIG-ZAG
+      else {
+        rotateUp(n);
+        rotateUp(n);
+      }
+    }
+}
+
+// removes the items one at a time, splaying as remove does
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::eraseRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    while(first != last) {
+      Node<Key, Value>* next = BinarySearchTree<Key, Value, Compare>::successor(first);
+      delete detachNode(first);
+      first = next;
+    }
+}
+
+/*
+---------------------------------------------
+End implementations for the SplayTree class.
+---------------------------------------------
+*/
+
+#endif
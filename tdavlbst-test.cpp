@@ -0,0 +1,90 @@
+#include <iostream>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <vector>
+#include "tdavlbst.h"
+#include "tree-check.h"
+
+using namespace std;
+
+typedef TopDownAVLTree<int,int> Tree;
+
+static bool balanced(const Tree& tree)
+{
+    return tree.isBalanced();
+}
+
+// sorted runs are the worst case for the top-down rotations
+static void testSortedRuns()
+{
+    Tree tree;
+    map<int,int> ref;
+    for(int i = 0; i < 5000; i++) {
+      tree.insert(make_pair(i, i));
+      ref[i] = i;
+    }
+    for(int i = 9999; i >= 5000; i--) {
+      tree.insert(make_pair(i, -i));
+      ref[i] = -i;
+    }
+    CHECK(tree.isBalanced());
+    CHECK(sameItems(tree, ref));
+
+    // remove every other key from the front, then the rest from the back
+    for(int i = 0; i < 10000; i += 2) {
+      tree.remove(i);
+      ref.erase(i);
+    }
+    CHECK(tree.isBalanced());
+    CHECK(sameItems(tree, ref));
+    for(int i = 9999; i >= 0; i--) {
+      tree.remove(i);
+      ref.erase(i);
+      if(i % 1000 == 1) CHECK(tree.isBalanced());
+    }
+    CHECK(tree.empty());
+    CHECK(tree.begin() == tree.end());
+}
+
+static void testRandomChurn()
+{
+    // many distinct keys, then few keys so inserts often overwrite
+    for(unsigned seed = 1; seed <= 3; seed++) {
+      Tree tree;
+      map<int,int> ref;
+      churn(tree, ref, seed, 20000, 2000, balanced);
+      churn(tree, ref, seed + 10, 5000, 40, balanced);
+    }
+}
+
+static void testAccessors()
+{
+    Tree tree;
+    vector<int> keys;
+    for(int i = 0; i < 1000; i++) keys.push_back(i);
+    shuffle(keys.begin(), keys.end(), mt19937(7));
+    for(size_t i = 0; i < keys.size(); i++) tree.insert(make_pair(keys[i], 0));
+    for(size_t i = 0; i < keys.size(); i++) tree[keys[i]] = keys[i] * 2;
+
+    const Tree& constTree = tree;
+    bool ok = true;
+    for(int i = 0; i < 1000; i++) ok = ok && constTree[i] == i * 2;
+    CHECK(ok);
+    CHECK(tree.find(1000) == tree.end());
+    tree.insert(make_pair(5, 0));
+    CHECK(tree.find(5)->second == 0);
+
+    tree.clear();
+    CHECK(tree.empty());
+    tree.insert(make_pair(1, 1));
+    CHECK(tree.begin()->first == 1 && tree.isBalanced());
+}
+
+int main()
+{
+    testSortedRuns();
+    testRandomChurn();
+    testAccessors();
+    return checkResult("tdavlbst-test");
+}
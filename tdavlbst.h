@@ -0,0 +1,659 @@
+#ifndef TDAVLBST_H
+#define TDAVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include "keycompare.h"
+
+/**
+* The height of an AVL tree with n nodes is below 1.4405 * log2(n + 2), so a path
+* stack of this many entries covers any tree that fits in a 64-bit address space.
+*/
+#define TDAVL_MAX_HEIGHT 96
+
+/**
+* A node for the top-down AVL tree.  Unlike Node/AVLNode it has no parent pointer
+* and no virtual functions, so each node is just the item, two links and the balance.
+* Children are addressed by direction (0 = left, 1 = right) so that the rebalancing
+* code can be written once for both sides.
+*/
+template <typename Key, typename Value>
+class TDAVLNode
+{
+public:
+    TDAVLNode(const Key& key, const Value& value);
+
+    const std::pair<const Key, Value>& getItem() const;
+    std::pair<const Key, Value>& getItem();
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+    void setValue(const Value& value);
+
+    TDAVLNode<Key, Value>* getLeft() const;
+    TDAVLNode<Key, Value>* getRight() const;
+    TDAVLNode<Key, Value>* getChild(int dir) const;
+    void setChild(int dir, TDAVLNode<Key, Value>* child);
+
+    int8_t getBalance() const;
+    void setBalance(int8_t balance);
+
+protected:
+    std::pair<const Key, Value> item_;
+    TDAVLNode<Key, Value>* link_[2];
+    int8_t balance_;    // height(right) - height(left)
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the TDAVLNode class.
+  -------------------------------------------------
+*/
+
+/**
+* Explicit constructor for a leaf node.
+*/
+template<typename Key, typename Value>
+TDAVLNode<Key, Value>::TDAVLNode(const Key& key, const Value& value) :
+    item_(key, value),
+    balance_(0)
+{
+    link_[0] = link_[1] = NULL;
+}
+
+template<typename Key, typename Value>
+const std::pair<const Key, Value>& TDAVLNode<Key, Value>::getItem() const
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>& TDAVLNode<Key, Value>::getItem()
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+const Key& TDAVLNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+template<typename Key, typename Value>
+const Value& TDAVLNode<Key, Value>::getValue() const
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value>
+Value& TDAVLNode<Key, Value>::getValue()
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value>
+void TDAVLNode<Key, Value>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+template<typename Key, typename Value>
+TDAVLNode<Key, Value>* TDAVLNode<Key, Value>::getLeft() const
+{
+    return link_[0];
+}
+
+template<typename Key, typename Value>
+TDAVLNode<Key, Value>* TDAVLNode<Key, Value>::getRight() const
+{
+    return link_[1];
+}
+
+template<typename Key, typename Value>
+TDAVLNode<Key, Value>* TDAVLNode<Key, Value>::getChild(int dir) const
+{
+    return link_[dir];
+}
+
+template<typename Key, typename Value>
+void TDAVLNode<Key, Value>::setChild(int dir, TDAVLNode<Key, Value>* child)
+{
+    link_[dir] = child;
+}
+
+template<typename Key, typename Value>
+int8_t TDAVLNode<Key, Value>::getBalance() const
+{
+    return balance_;
+}
+
+template<typename Key, typename Value>
+void TDAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the TDAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVL tree that keeps no parent pointers.
+*
+* Insertion is a single top-down pass: the descent remembers the deepest node
+* with a non-zero balance, which is the only node that can need a rotation, and
+* only the balances below it are adjusted.  Removal records its path in a bounded
+* stack and retraces it, stopping as soon as a subtree's height is unchanged.
+* Iterators carry their own ancestor stack instead of climbing parent links.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class TopDownAVLTree
+{
+public:
+    TopDownAVLTree();
+    explicit TopDownAVLTree(const Compare& comp);
+    ~TopDownAVLTree();
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    bool empty() const;
+
+    /**
+    * An in-order iterator.  The stack holds the current node on top and,
+    * below it, every ancestor whose left subtree contains the current node.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class TopDownAVLTree<Key, Value, Compare>;
+        void pushLeftSpine(TDAVLNode<Key, Value>* n);
+        TDAVLNode<Key, Value>* current() const;
+
+        TDAVLNode<Key, Value>* stack_[TDAVL_MAX_HEIGHT];
+        int depth_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    TDAVLNode<Key, Value>* internalFind(const Key& key) const;
+    static TDAVLNode<Key, Value>* rotate(TDAVLNode<Key, Value>* n, int dir);
+    static TDAVLNode<Key, Value>* rotateDouble(TDAVLNode<Key, Value>* n, int dir);
+    static TDAVLNode<Key, Value>* insertRebalance(TDAVLNode<Key, Value>* n, int dir);
+    static TDAVLNode<Key, Value>* removeRebalance(TDAVLNode<Key, Value>* n, int dir, bool& done);
+    static int isBalancedHelper(TDAVLNode<Key, Value>* n);
+    static void clearHelper(TDAVLNode<Key, Value>* n);
+
+private:
+    // Copying would share nodes between trees.
+    TopDownAVLTree(const TopDownAVLTree&);
+    TopDownAVLTree& operator=(const TopDownAVLTree&);
+
+protected:
+    TDAVLNode<Key, Value>* root_;
+    Compare comp_;
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the TopDownAVLTree::iterator class.
+--------------------------------------------------------------
+*/
+
+/**
+* A default constructor that initializes the iterator to the end.
+*/
+template<class Key, class Value, class Compare>
+TopDownAVLTree<Key, Value, Compare>::iterator::iterator() : depth_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+TDAVLNode<Key, Value>* TopDownAVLTree<Key, Value, Compare>::iterator::current() const
+{
+    return depth_ ? stack_[depth_ - 1] : NULL;
+}
+
+// pushes n and every node along its left spine
+template<class Key, class Value, class Compare>
+void TopDownAVLTree<Key, Value, Compare>::iterator::pushLeftSpine(TDAVLNode<Key, Value>* n)
+{
+    while(n) {
+        stack_[depth_++] = n;
+        n = n->getLeft();
+    }
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value>&
+TopDownAVLTree<Key, Value, Compare>::iterator::operator*() const
+{
+    return current()->getItem();
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value>*
+TopDownAVLTree<Key, Value, Compare>::iterator::operator->() const
+{
+    return &(current()->getItem());
+}
+
+template<class Key, class Value, class Compare>
+bool TopDownAVLTree<Key, Value, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    return current() == rhs.current();
+}
+
+template<class Key, class Value, class Compare>
+bool TopDownAVLTree<Key, Value, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return current() != rhs.current();
+}
+
+/**
+* Advances to the in-order successor: pop the current node, then descend the
+* left spine of its right subtree.  No parent links are followed.
+*/
+template<class Key, class Value, class Compare>
+typename TopDownAVLTree<Key, Value, Compare>::iterator&
+TopDownAVLTree<Key, Value, Compare>::iterator::operator++()
+{
+    TDAVLNode<Key, Value>* n = stack_[--depth_];
+    pushLeftSpine(n->getRight());
+    return *this;
+}
+
+/*
+------------------------------------------------------------
+End implementations for the TopDownAVLTree::iterator class.
+------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the TopDownAVLTree class.
+-----------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+TopDownAVLTree<Key, Value, Compare>::TopDownAVLTree() : root_(NULL)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+TopDownAVLTree<Key, Value, Compare>::TopDownAVLTree(const Compare& comp) : root_(NULL), comp_(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+TopDownAVLTree<Key, Value, Compare>::~TopDownAVLTree()
+{
+    clearHelper(root_);
+}
+
+template<class Key, class Value, class Compare>
+bool TopDownAVLTree<Key, Value, Compare>::empty() const
+{
+    return root_ == NULL;
+}
+
+template<class Key, class Value, class Compare>
+void TopDownAVLTree<Key, Value, Compare>::clear()
+{
+    clearHelper(root_);
+    root_ = NULL;
+}
+
+template<class Key, class Value, class Compare>
+void TopDownAVLTree<Key, Value, Compare>::clearHelper(TDAVLNode<Key, Value>* n)
+{
+    if(!n) return;
+    clearHelper(n->getLeft());
+    clearHelper(n->getRight());
+    delete n;
+}
+
+template<class Key, class Value, class Compare>
+typename TopDownAVLTree<Key, Value, Compare>::iterator
+TopDownAVLTree<Key, Value, Compare>::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+template<class Key, class Value, class Compare>
+typename TopDownAVLTree<Key, Value, Compare>::iterator
+TopDownAVLTree<Key, Value, Compare>::end() const
+{
+    return iterator();
+}
+
+/**
+* Returns an iterator to the item with the given key, or end().  The
+* ancestors passed on the left are kept so the iterator can advance.
+*/
+template<class Key, class Value, class Compare>
+typename TopDownAVLTree<Key, Value, Compare>::iterator
+TopDownAVLTree<Key, Value, Compare>::find(const Key& key) const
+{
+    iterator it;
+    TDAVLNode<Key, Value>* current = root_;
+    while(current) {
+        int c = compareWith(comp_, key, current->getKey());
+        if(c < 0) {
+            it.stack_[it.depth_++] = current;
+            current = current->getLeft();
+        }
+        else if(c > 0) {
+            current = current->getRight();
+        }
+        else {
+            it.stack_[it.depth_++] = current;
+            return it;
+        }
+    }
+    return iterator();
+}
+
+template<class Key, class Value, class Compare>
+TDAVLNode<Key, Value>* TopDownAVLTree<Key, Value, Compare>::internalFind(const Key& key) const
+{
+    TDAVLNode<Key, Value>* current = root_;
+    while(current) {
+        int c = compareWith(comp_, key, current->getKey());
+        if(c < 0) current = current->getLeft();
+        else if(c > 0) current = current->getRight();
+        else break;
+    }
+    return current;
+}
+
+template<class Key, class Value, class Compare>
+Value& TopDownAVLTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    TDAVLNode<Key, Value>* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+template<class Key, class Value, class Compare>
+Value const & TopDownAVLTree<Key, Value, Compare>::operator[](const Key& key) const
+{
+    TDAVLNode<Key, Value>* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+// Single rotation that lifts n's child on side dir; returns the new subtree root.
+// Balances are left to the caller.
+template<class Key, class Value, class Compare>
+TDAVLNode<Key, Value>* TopDownAVLTree<Key, Value, Compare>::rotate(TDAVLNode<Key, Value>* n, int dir)
+{
+    TDAVLNode<Key, Value>* c = n->getChild(dir);
+    n->setChild(dir, c->getChild(!dir));
+    c->setChild(!dir, n);
+    return c;
+}
+
+// Double rotation that lifts the grandchild n->dir->!dir and fixes all three
+// balances from the grandchild's old balance.
+template<class Key, class Value, class Compare>
+TDAVLNode<Key, Value>* TopDownAVLTree<Key, Value, Compare>::rotateDouble(TDAVLNode<Key, Value>* n, int dir)
+{
+    TDAVLNode<Key, Value>* c = n->getChild(dir);
+    TDAVLNode<Key, Value>* g = c->getChild(!dir);
+    int8_t heavy = dir ? 1 : -1;
+
+    // CASE 1: g leaned towards dir, so n loses that height
+    if(g->getBalance() == heavy) {
+        n->setBalance(-heavy); c->setBalance(0);
+    }
+    // CASE 2: g leaned away from dir, so c loses that height
+    else if(g->getBalance() == -heavy) {
+        n->setBalance(0); c->setBalance(heavy);
+    }
+    // CASE 3: g was balanced
+    else {
+        n->setBalance(0); c->setBalance(0);
+    }
+    g->setBalance(0);
+
+    n->setChild(dir, rotate(c, !dir));
+    return rotate(n, dir);
+}
+
+// n is two levels heavier on side dir after an insert; returns the new subtree
+// root, whose height equals n's height before the insert.
+template<class Key, class Value, class Compare>
+TDAVLNode<Key, Value>* TopDownAVLTree<Key, Value, Compare>::insertRebalance(TDAVLNode<Key, Value>* n, int dir)
+{
+    TDAVLNode<Key, Value>* c = n->getChild(dir);
+    int8_t heavy = dir ? 1 : -1;
+
+    // CASE 1: ZIG-ZIG
+    if(c->getBalance() == heavy) {
+        n->setBalance(0); c->setBalance(0);
+        return rotate(n, dir);
+    }
+    // CASE 2: ZIG-ZAG
+    return rotateDouble(n, dir);
+}
+
+// n is two levels heavier on side dir after a removal on the other side.
+// done is set when the subtree height did not change, which ends the retrace.
+template<class Key, class Value, class Compare>
+TDAVLNode<Key, Value>* TopDownAVLTree<Key, Value, Compare>::removeRebalance(TDAVLNode<Key, Value>* n, int dir, bool& done)
+{
+    TDAVLNode<Key, Value>* c = n->getChild(dir);
+    int8_t heavy = dir ? 1 : -1;
+
+    // CASE 1: ZIG-ZIG, height drops by one
+    if(c->getBalance() == heavy) {
+        n->setBalance(0); c->setBalance(0);
+        return rotate(n, dir);
+    }
+    // CASE 2: ZIG-ZIG with a balanced child, height is unchanged
+    if(c->getBalance() == 0) {
+        n->setBalance(heavy); c->setBalance(-heavy);
+        done = true;
+        return rotate(n, dir);
+    }
+    // CASE 3: ZIG-ZAG, height drops by one
+    return rotateDouble(n, dir);
+}
+
+/**
+* Inserts in one downward pass.  s is the deepest node on the path with a
+* non-zero balance: nodes below it only shift their balance by one, and s is
+* the only node that can go out of balance.  If the key exists its value is
+* overwritten.
+*/
+template<class Key, class Value, class Compare>
+void TopDownAVLTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    const Key& key = keyValuePair.first;
+    if(!root_) {
+        root_ = new TDAVLNode<Key, Value>(key, keyValuePair.second);
+        return;
+    }
+
+    // directions taken from each node on the path, indexed by depth
+    uint8_t dirs[TDAVL_MAX_HEIGHT];
+    TDAVLNode<Key, Value>* sParent = NULL;   // parent of s, NULL if s is the root
+    TDAVLNode<Key, Value>* s = root_;
+    int sDepth = 0;
+
+    TDAVLNode<Key, Value>* p = root_;
+    int depth = 0;
+    for(;;) {
+        int c = compareWith(comp_, key, p->getKey());
+        int dir;
+        if(c < 0) dir = 0;
+        else if(c > 0) dir = 1;
+        else {
+            p->setValue(keyValuePair.second);
+            return;
+        }
+        dirs[depth] = (uint8_t)dir;
+        TDAVLNode<Key, Value>* q = p->getChild(dir);
+        if(!q) {
+            q = new TDAVLNode<Key, Value>(key, keyValuePair.second);
+            p->setChild(dir, q);
+            break;
+        }
+        depth++;
+        if(q->getBalance() != 0) {
+            sParent = p;
+            s = q;
+            sDepth = depth;
+        }
+        p = q;
+    }
+
+    // every node from s down to the new leaf gains height on the side taken
+    TDAVLNode<Key, Value>* n = s;
+    for(int d = sDepth; d <= depth; d++) {
+        n->setBalance(n->getBalance() + (dirs[d] ? 1 : -1));
+        n = n->getChild(dirs[d]);
+    }
+
+    if(s->getBalance() == 2 || s->getBalance() == -2) {
+        TDAVLNode<Key, Value>* top = insertRebalance(s, dirs[sDepth]);
+        if(!sParent) root_ = top;
+        else sParent->setChild(dirs[sDepth - 1], top);
+    }
+}
+
+/**
+* Removes the key if present.  A node with two children is replaced by its
+* predecessor (relinked, not copied, since keys are const).  The path is
+* kept in a bounded stack and retraced until a subtree keeps its height.
+*/
+template<class Key, class Value, class Compare>
+void TopDownAVLTree<Key, Value, Compare>::remove(const Key& key)
+{
+    TDAVLNode<Key, Value>* path[TDAVL_MAX_HEIGHT];
+    uint8_t dirs[TDAVL_MAX_HEIGHT];
+    int depth = 0;
+
+    TDAVLNode<Key, Value>* target = root_;
+    while(target) {
+        int c = compareWith(comp_, key, target->getKey());
+        int dir;
+        if(c < 0) dir = 0;
+        else if(c > 0) dir = 1;
+        else break;
+        path[depth] = target;
+        dirs[depth++] = (uint8_t)dir;
+        target = target->getChild(dir);
+    }
+
+    // CASE 1: key is not in the tree
+    if(!target) return;
+
+    int targetDepth = depth;
+    TDAVLNode<Key, Value>* victim = target;
+
+    // CASE 2: two children, unlink the predecessor instead
+    if(target->getLeft() && target->getRight()) {
+        path[depth] = target;
+        dirs[depth++] = 0;
+        victim = target->getLeft();
+        while(victim->getRight()) {
+            path[depth] = victim;
+            dirs[depth++] = 1;
+            victim = victim->getRight();
+        }
+    }
+
+    // splice out the victim, which has at most one child
+    TDAVLNode<Key, Value>* child = victim->getLeft() ? victim->getLeft() : victim->getRight();
+    if(depth == 0) root_ = child;
+    else path[depth - 1]->setChild(dirs[depth - 1], child);
+
+    // move the predecessor into the target's position
+    if(victim != target) {
+        victim->setChild(0, target->getLeft());
+        victim->setChild(1, target->getRight());
+        victim->setBalance(target->getBalance());
+        if(targetDepth == 0) root_ = victim;
+        else path[targetDepth - 1]->setChild(dirs[targetDepth - 1], victim);
+        path[targetDepth] = victim;
+    }
+    delete target;
+
+    // retrace: the subtree on side dirs[d] of path[d] lost one level
+    bool done = false;
+    for(int d = depth - 1; d >= 0 && !done; d--) {
+        TDAVLNode<Key, Value>* n = path[d];
+        int dir = dirs[d];
+        n->setBalance(n->getBalance() + (dir ? -1 : 1));
+
+        // CASE A: was balanced, now leans away; height unchanged
+        if(n->getBalance() == 1 || n->getBalance() == -1) break;
+        // CASE B: lost its taller side; height drops, keep going
+        if(n->getBalance() == 0) continue;
+
+        // CASE C: out of balance towards the other side
+        TDAVLNode<Key, Value>* top = removeRebalance(n, !dir, done);
+        if(d == 0) root_ = top;
+        else path[d - 1]->setChild(dirs[d - 1], top);
+    }
+}
+
+/**
+ * Return true iff every node's subtree heights differ by at most one.
+ */
+template<class Key, class Value, class Compare>
+bool TopDownAVLTree<Key, Value, Compare>::isBalanced() const
+{
+    return isBalancedHelper(root_) >= 0;
+}
+
+// returns height of the subtree, or -1 if it is not balanced or a stored
+// balance disagrees with the real heights
+template<class Key, class Value, class Compare>
+int TopDownAVLTree<Key, Value, Compare>::isBalancedHelper(TDAVLNode<Key, Value>* n)
+{
+    if(!n) return 0;
+    int left = isBalancedHelper(n->getLeft());
+    int right = isBalancedHelper(n->getRight());
+    if(left < 0 || right < 0 || abs(right - left) > 1 || right - left != n->getBalance())
+        return -1;
+    return 1 + std::max(left, right);
+}
+
+/*
+---------------------------------------------------
+End implementations for the TopDownAVLTree class.
+---------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef TREE_CHECK_H
+#define TREE_CHECK_H
+
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+#include <utility>
+
+/**
+* Helpers for the assertion-based test drivers (*-test.cpp with a matching
+* header).  CHECK reports a failed condition with its location and keeps
+* going, so one run lists every failure; main returns checkResult().
+* The trees are compared against std::map / std::multimap, which serve as the
+* reference implementation.
+*/
+
+static int g_failedChecks = 0;
+
+#define CHECK(cond) \
+    do { \
+      if(!(cond)) { \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #cond << std::endl; \
+        g_failedChecks++; \
+      } \
+    } while(0)
+
+// prints a summary line and returns the exit code for main
+inline int checkResult(const char* name)
+{
+    if(g_failedChecks) {
+      std::cout << name << ": " << g_failedChecks << " checks failed" << std::endl;
+      return 1;
+    }
+    std::cout << name << ": all checks passed" << std::endl;
+    return 0;
+}
+
+// true if an in-order walk of tree gives exactly the items of ref, in order
+template<typename Tree, typename Map>
+bool sameItems(const Tree& tree, const Map& ref)
+{
+    typename Map::const_iterator r = ref.begin();
+    for(auto it = tree.begin(); it != tree.end(); ++it, ++r) {
+      if(r == ref.end() || it->first != r->first || it->second != r->second) return false;
+    }
+    return r == ref.end();
+}
+
+// true if find() agrees with ref for every key in [0, keys)
+template<typename Tree>
+bool sameLookups(const Tree& tree, const std::map<int, int>& ref, int keys)
+{
+    for(int key = 0; key < keys; key++) {
+      auto it = tree.find(key);
+      std::map<int, int>::const_iterator r = ref.find(key);
+      if((it == tree.end()) != (r == ref.end())) return false;
+      if(r != ref.end() && it->second != r->second) return false;
+    }
+    return true;
+}
+
+// height of the subtree at n (0 if empty); recursive, so only for trees
+// that are known to be shallow
+template<typename NodeT>
+int subtreeHeight(const NodeT* n)
+{
+    if(!n) return 0;
+    return 1 + std::max(subtreeHeight(n->getLeft()), subtreeHeight(n->getRight()));
+}
+
+/**
+* True if the nodes of tree form a valid search tree: every child points back
+* at its parent, the root has none, the in-order keys strictly increase and
+* there are size() of them.  Iterative, so degenerate trees are fine.
+*/
+template<typename Tree>
+bool isSearchTree(const Tree& tree)
+{
+    typedef typename std::remove_pointer<decltype(tree.rootNode())>::type NodeT;
+    std::vector<NodeT*> stack;
+    NodeT* root = tree.rootNode();
+    if(root && root->getParent()) return false;
+    if(root) stack.push_back(root);
+    size_t nodes = 0;
+    while(!stack.empty()) {
+      NodeT* n = stack.back();
+      stack.pop_back();
+      nodes++;
+      if(n->getLeft()) {
+        if(n->getLeft()->getParent() != n) return false;
+        stack.push_back(n->getLeft());
+      }
+      if(n->getRight()) {
+        if(n->getRight()->getParent() != n) return false;
+        stack.push_back(n->getRight());
+      }
+    }
+    if(nodes != tree.size()) return false;
+
+    auto prev = tree.begin();
+    if(prev == tree.end()) return true;
+    for(auto it = std::next(prev); it != tree.end(); prev = it, ++it) {
+      if(!(prev->first < it->first)) return false;
+    }
+    return true;
+}
+
+/**
+* Runs ops random inserts (two thirds) and removes of keys in [0, keys) on
+* tree and mirrors them in ref.  valid(tree) is checked every so often and at
+* the end, along with the items and lookups.
+*/
+template<typename Tree, typename Valid>
+void churn(Tree& tree, std::map<int, int>& ref, unsigned seed, int ops, int keys, Valid valid)
+{
+    std::mt19937 rng(seed);
+    for(int i = 0; i < ops; i++) {
+      int key = rng() % keys;
+      if(rng() % 3) {
+        tree.insert(std::make_pair(key, i));
+        ref[key] = i;
+      }
+      else {
+        tree.remove(key);
+        ref.erase(key);
+      }
+      if(i % 97 == 0) CHECK(valid(tree));
+    }
+    CHECK(valid(tree));
+    CHECK(sameItems(tree, ref));
+    CHECK(sameLookups(tree, ref, keys));
+}
+
+#endif
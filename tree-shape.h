@@ -0,0 +1,273 @@
+#ifndef TREE_SHAPE_H
+#define TREE_SHAPE_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <map>
+#include <ostream>
+#include <utility>
+#include <vector>
+#include "work-stealing-pool.h"
+
+/**
+* Shape analytics for binary trees: one O(n) pass that reports how deep the
+* nodes and leaves sit, how full each level is and (for AVL nodes) how the
+* balance factors are spread.
+*
+* The pass reads nodes through ShapeTraits, so it works on any node type
+* without knowing it.  Nodes with getLeft()/getRight() (bst.h and every tree
+* built on it) and nodes with public left/right pointers (equal-paths.h) are
+* recognized out of the box, and a getBalance() member is picked up when
+* present.  Other node types can specialize ShapeTraits.  This header includes
+* neither node definition, so it can be used with either.
+*/
+
+/**
+* The profile.  Levels count from 0 at the root; depths count nodes on the
+* path, so the root has depth 1 and a search that ends at level l visits
+* l + 1 nodes.
+*/
+struct TreeShape
+{
+    TreeShape() : nodes(0), leaves(0), totalDepth(0) { }
+
+    size_t nodes;
+    size_t leaves;
+    // sum of the depths of all nodes
+    uint64_t totalDepth;
+    // nodes and leaves per level; leafLevels is the leaf-depth histogram
+    std::vector<size_t> levelNodes;
+    std::vector<size_t> leafLevels;
+    // balance factor -> node count, empty unless the nodes have balances
+    std::map<int, size_t> balances;
+
+    // height in nodes, 0 when empty
+    size_t height() const;
+    // average and worst nodes visited by a successful search
+    double averageDepth() const;
+    size_t maxDepth() const;
+    // fraction of the 2^level possible nodes present on a level
+    double levelFill(size_t level) const;
+    // height over the smallest possible height for this many nodes
+    double skew() const;
+    // true if every leaf has the same depth (what equalPaths checks)
+    bool equalLeafDepths() const;
+
+    void add(const TreeShape& other);
+    void print(std::ostream& os) const;
+};
+
+/**
+* How the pass reads a node type: its children and, if it has one, its
+* balance factor.  The primary template uses public left/right pointers.
+*/
+template<typename N, typename = void>
+struct ShapeTraits
+{
+    typedef const N* Ptr;
+    static Ptr left(const N* n) { return n->left; }
+    static Ptr right(const N* n) { return n->right; }
+};
+
+template<typename...>
+struct ShapeVoid
+{
+    typedef void type;
+};
+
+// nodes with getLeft()/getRight(); children come back as the type the
+// getters return, so AVLNode subtrees keep their balances
+template<typename N>
+struct ShapeTraits<N, typename ShapeVoid<decltype(std::declval<const N&>().getLeft())>::type>
+{
+    typedef const N* Ptr;
+    static Ptr left(const N* n) { return n->getLeft(); }
+    static Ptr right(const N* n) { return n->getRight(); }
+};
+
+template<typename N, typename = void>
+struct ShapeBalance
+{
+    static void record(const N*, TreeShape&) { }
+};
+
+template<typename N>
+struct ShapeBalance<N, typename ShapeVoid<decltype(std::declval<const N&>().getBalance())>::type>
+{
+    static void record(const N* n, TreeShape& shape) { shape.balances[(int)n->getBalance()]++; }
+};
+
+template<typename N>
+TreeShape profileShape(const N* root);
+template<typename N>
+TreeShape profileShape(const N* root, WorkStealingPool& pool);
+
+/*
+  -------------------------------------------
+  Begin implementations for the shape pass.
+  -------------------------------------------
+*/
+
+inline size_t TreeShape::height() const
+{
+    return levelNodes.size();
+}
+
+inline double TreeShape::averageDepth() const
+{
+    return nodes ? (double)totalDepth / nodes : 0;
+}
+
+inline size_t TreeShape::maxDepth() const
+{
+    return height();
+}
+
+inline double TreeShape::levelFill(size_t level) const
+{
+    if(level >= levelNodes.size()) return 0;
+    return levelNodes[level] / std::ldexp(1.0, (int)level);
+}
+
+inline double TreeShape::skew() const
+{
+    if(!nodes) return 1;
+    return height() / std::ceil(std::log2((double)nodes + 1));
+}
+
+inline bool TreeShape::equalLeafDepths() const
+{
+    size_t depths = 0;
+    for(size_t i = 0; i < leafLevels.size(); i++) {
+        if(leafLevels[i]) depths++;
+    }
+    return depths <= 1;
+}
+
+// merges the profile of a disjoint part of the same tree
+inline void TreeShape::add(const TreeShape& other)
+{
+    nodes += other.nodes;
+    leaves += other.leaves;
+    totalDepth += other.totalDepth;
+    if(levelNodes.size() < other.levelNodes.size()) levelNodes.resize(other.levelNodes.size());
+    if(leafLevels.size() < other.leafLevels.size()) leafLevels.resize(other.leafLevels.size());
+    for(size_t i = 0; i < other.levelNodes.size(); i++) levelNodes[i] += other.levelNodes[i];
+    for(size_t i = 0; i < other.leafLevels.size(); i++) leafLevels[i] += other.leafLevels[i];
+    for(std::map<int, size_t>::const_iterator it = other.balances.begin(); it != other.balances.end(); ++it) {
+        balances[it->first] += it->second;
+    }
+}
+
+/**
+* A plain-text report: totals, then one line per level with its fill and
+* leaves, then the balance factors if there are any.
+*/
+inline void TreeShape::print(std::ostream& os) const
+{
+    os << "nodes " << nodes << ", leaves " << leaves << ", height " << height()
+       << ", average depth " << averageDepth() << ", skew " << skew()
+       << (equalLeafDepths() ? ", equal leaf depths" : "") << std::endl;
+    for(size_t level = 0; level < levelNodes.size(); level++) {
+        os << "  level " << level << ": " << levelNodes[level] << " nodes (fill "
+           << levelFill(level) << "), " << leafLevels[level] << " leaves" << std::endl;
+    }
+    for(std::map<int, size_t>::const_iterator it = balances.begin(); it != balances.end(); ++it) {
+        os << "  balance " << it->first << ": " << it->second << std::endl;
+    }
+}
+
+// the pass over one subtree whose root sits on the given level; iterative,
+// so a degenerate tree cannot overflow the call stack
+template<typename N>
+void profileSubtree(const N* root, size_t level, TreeShape& shape)
+{
+    typedef ShapeTraits<N> Traits;
+    std::vector<std::pair<typename Traits::Ptr, size_t> > stack;
+    if(root) stack.push_back(std::make_pair(typename Traits::Ptr(root), level));
+
+    while(!stack.empty()) {
+        typename Traits::Ptr n = stack.back().first;
+        level = stack.back().second;
+        stack.pop_back();
+
+        if(shape.levelNodes.size() <= level) {
+            shape.levelNodes.resize(level + 1);
+            shape.leafLevels.resize(level + 1);
+        }
+        shape.nodes++;
+        shape.levelNodes[level]++;
+        shape.totalDepth += level + 1;
+        ShapeBalance<N>::record(n, shape);
+
+        typename Traits::Ptr left = Traits::left(n);
+        typename Traits::Ptr right = Traits::right(n);
+        if(!left && !right) {
+            shape.leaves++;
+            shape.leafLevels[level]++;
+        }
+        if(right) stack.push_back(std::make_pair(right, level + 1));
+        if(left) stack.push_back(std::make_pair(left, level + 1));
+    }
+}
+
+// the top splitDepth levels fork: the left subtree goes to the pool
+template<typename N>
+void profilePart(const N* n, size_t level, int splitDepth, WorkStealingPool& pool, TreeShape& shape)
+{
+    typedef ShapeTraits<N> Traits;
+    typename Traits::Ptr left = Traits::left(n);
+    typename Traits::Ptr right = Traits::right(n);
+    if(splitDepth == 0 || !left || !right) {
+        profileSubtree(n, level, shape);
+        return;
+    }
+
+    TreeShape leftShape;
+    WorkStealingPool::TaskGroup group;
+    pool.spawn(group, [&]() { profilePart(left, level + 1, splitDepth - 1, pool, leftShape); });
+    profilePart(right, level + 1, splitDepth - 1, pool, shape);
+    pool.wait(group);
+    shape.add(leftShape);
+
+    // n itself, which has two children
+    if(shape.levelNodes.size() <= level) {
+        shape.levelNodes.resize(level + 1);
+        shape.leafLevels.resize(level + 1);
+    }
+    shape.nodes++;
+    shape.levelNodes[level]++;
+    shape.totalDepth += level + 1;
+    ShapeBalance<N>::record(n, shape);
+}
+
+template<typename N>
+TreeShape profileShape(const N* root)
+{
+    TreeShape shape;
+    profileSubtree(root, 0, shape);
+    return shape;
+}
+
+/**
+* The same pass with the top of the tree split into subtrees on pool; the
+* parts are profiled independently and merged.
+*/
+template<typename N>
+TreeShape profileShape(const N* root, WorkStealingPool& pool)
+{
+    TreeShape shape;
+    if(!root) return shape;
+
+    profilePart(root, 0, pool.forkDepth(), pool, shape);
+    return shape;
+}
+
+/*
+  -----------------------------------------
+  End implementations for the shape pass.
+  -----------------------------------------
+*/
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <cstdlib>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+/**
+* A fork-join thread pool for divide-and-conquer work over trees.  Every
+* worker owns a deque: tasks it spawns go on the back and it pops them from
+* the back (depth first, cache-warm), while idle workers steal from the front
+* of the others, which holds the oldest and so usually the largest subtree.
+* Threads outside the pool share one extra deque.
+*
+* Tasks are counted in a TaskGroup.  wait() runs queued tasks on the calling
+* thread until the group is done, so a task may spawn children and wait for
+* them without tying up its worker, and a pool with zero workers still runs
+* everything (on the waiting thread).
+*/
+class WorkStealingPool
+{
+public:
+    /**
+    * A set of spawned tasks that can be waited for.  The first exception a
+    * task throws is rethrown by wait().
+    */
+    class TaskGroup
+    {
+    public:
+        TaskGroup() : pending_(0) { }
+
+    private:
+        friend class WorkStealingPool;
+        TaskGroup(const TaskGroup&);
+        TaskGroup& operator=(const TaskGroup&);
+
+        std::atomic<size_t> pending_;
+        std::mutex errorLock_;
+        std::exception_ptr error_;
+    };
+
+    // threads is the number of workers; the default leaves one hardware
+    // thread for the caller, who helps while it waits
+    explicit WorkStealingPool(unsigned threads = defaultThreads());
+    ~WorkStealingPool();
+
+    unsigned threads() const;
+    // levels of binary forking that give every thread about four tasks
+    int forkDepth() const;
+    void spawn(TaskGroup& group, std::function<void()> task);
+    void wait(TaskGroup& group);
+
+    static unsigned defaultThreads();
+    // a process-wide pool with the default thread count, started on first use
+    static WorkStealingPool& shared();
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    WorkStealingPool(const WorkStealingPool&);
+    WorkStealingPool& operator=(const WorkStealingPool&);
+
+    struct WorkerSlot
+    {
+        const WorkStealingPool* pool;
+        size_t index;
+    };
+
+    static WorkerSlot& workerSlot();
+    size_t currentQueue() const;
+    bool takeTask(size_t self, std::function<void()>& task);
+    bool runOne(size_t self);
+    void workerLoop(size_t self);
+
+    // one deque per worker, plus the shared one at the end
+    std::vector<std::unique_ptr<Queue> > queues_;
+    std::vector<std::thread> workers_;
+    std::mutex sleepLock_;
+    std::condition_variable wake_;
+    std::atomic<size_t> queued_;
+    bool stopping_;
+};
+
+/*
+  ----------------------------------------------------
+  Begin implementations for the WorkStealingPool class.
+  ----------------------------------------------------
+*/
+
+inline WorkStealingPool::WorkStealingPool(unsigned threads) :
+    queued_(0),
+    stopping_(false)
+{
+    for(unsigned i = 0; i <= threads; i++) queues_.push_back(std::unique_ptr<Queue>(new Queue));
+    for(unsigned i = 0; i < threads; i++) workers_.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+}
+
+/**
+* Workers finish every queued task before they exit.
+*/
+inline WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepLock_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for(size_t i = 0; i < workers_.size(); i++) workers_[i].join();
+}
+
+inline unsigned WorkStealingPool::threads() const
+{
+    return (unsigned)workers_.size();
+}
+
+inline int WorkStealingPool::forkDepth() const
+{
+    int depth = 2;
+    while((1u << depth) < 4 * (threads() + 1)) depth++;
+    return depth;
+}
+
+inline unsigned WorkStealingPool::defaultThreads()
+{
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware > 1 ? hardware - 1 : 0;
+}
+
+inline WorkStealingPool& WorkStealingPool::shared()
+{
+    static WorkStealingPool pool;
+    return pool;
+}
+
+// which pool (if any) the calling thread works for, and its deque there
+inline WorkStealingPool::WorkerSlot& WorkStealingPool::workerSlot()
+{
+    static thread_local WorkerSlot slot = { NULL, 0 };
+    return slot;
+}
+
+// the deque of the calling thread: its own if it is one of our workers,
+// otherwise the shared one
+inline size_t WorkStealingPool::currentQueue() const
+{
+    const WorkerSlot& slot = workerSlot();
+    return slot.pool == this ? slot.index : queues_.size() - 1;
+}
+
+inline void WorkStealingPool::spawn(TaskGroup& group, std::function<void()> task)
+{
+    group.pending_++;
+    std::function<void()> counted = [&group, task]() {
+        try {
+            task();
+        }
+        catch(...) {
+            std::lock_guard<std::mutex> guard(group.errorLock_);
+            if(!group.error_) group.error_ = std::current_exception();
+        }
+        group.pending_--;
+    };
+
+    Queue& queue = *queues_[currentQueue()];
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_back(std::move(counted));
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepLock_);
+        queued_++;
+    }
+    wake_.notify_one();
+}
+
+/**
+* Runs queued tasks (any group's) until every task of group has finished.
+*/
+inline void WorkStealingPool::wait(TaskGroup& group)
+{
+    size_t self = currentQueue();
+    while(group.pending_ > 0) {
+        if(!runOne(self)) std::this_thread::yield();
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> guard(group.errorLock_);
+        std::swap(error, group.error_);
+    }
+    if(error) std::rethrow_exception(error);
+}
+
+// pops the newest task of our own deque, else steals the oldest task of the
+// next non-empty deque after ours
+inline bool WorkStealingPool::takeTask(size_t self, std::function<void()>& task)
+{
+    for(size_t i = 0; i < queues_.size(); i++) {
+        Queue& queue = *queues_[(self + i) % queues_.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if(queue.tasks.empty()) continue;
+        if(i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued_--;
+        return true;
+    }
+    return false;
+}
+
+inline bool WorkStealingPool::runOne(size_t self)
+{
+    std::function<void()> task;
+    if(!takeTask(self, task)) return false;
+    task();
+    return true;
+}
+
+inline void WorkStealingPool::workerLoop(size_t self)
+{
+    workerSlot().pool = this;
+    workerSlot().index = self;
+    for(;;) {
+        if(runOne(self)) continue;
+        std::unique_lock<std::mutex> lock(sleepLock_);
+        wake_.wait(lock, [this]() { return stopping_ || queued_ > 0; });
+        if(stopping_ && queued_ == 0) return;
+    }
+}
+
+/*
+  --------------------------------------------------
+  End implementations for the WorkStealingPool class.
+  --------------------------------------------------
+*/
+
+#endif